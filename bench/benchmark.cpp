@@ -0,0 +1,316 @@
+#include "../selective_time_series.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+// Build: cmake -S bench -B build-bench && cmake --build build-bench
+//    or: g++ -std=c++17 -O2 -march=native bench/benchmark.cpp -lbenchmark -lpthread
+// Run a subset with e.g. --benchmark_filter='add_warm/.*/float/'
+
+namespace {
+
+enum distribution : int {
+    uniform   = 0, // Random scores
+    improving = 1, // Every sample beats the current worst, always evicts
+    worsening = 2, // Every sample is worse than the current worst, always rejected
+};
+const char* const distribution_names[] = { "uniform", "improving", "worsening" };
+
+struct blob256 {
+    std::array<std::byte, 256> bytes {};
+    bool operator==(const blob256& other) const noexcept { return bytes == other.bytes; }
+};
+
+template <typename V> V make_value(std::size_t i);
+template <> float make_value<float>(std::size_t i) { return static_cast<float>(i); }
+template <> std::array<double, 8> make_value<std::array<double, 8>>(std::size_t i) {
+    const auto d = static_cast<double>(i);
+    return { d, d, d, d, d, d, d, d };
+}
+template <> blob256 make_value<blob256>(std::size_t i) {
+    blob256 b;
+    b.bytes[0] = static_cast<std::byte>(i);
+    return b;
+}
+
+// Source of scores, endless for improving/worsening, cycling for uniform.
+class scores {
+public:
+    explicit scores(const distribution d) : dist{d}, table(1 << 16) {
+        std::default_random_engine e { 1u }; // Will result in the same 'random' generation each run
+        std::uniform_real_distribution<float> rnd {0.0f, 1.0f};
+        for (auto& s : table) s = rnd(e);
+    }
+    float operator()(const std::size_t t) const noexcept {
+        switch (dist) {
+        case improving: return 1.0f / static_cast<float>(t + 2);
+        case worsening: return 1.0f + static_cast<float>(t);
+        default:        return table[t & (table.size() - 1)];
+        }
+    }
+private:
+    distribution dist;
+    std::vector<float> table;
+};
+
+template <typename V, std::size_t S, typename... Ps>
+using series = selective_time_series<V, S, false, std::size_t, float, Ps...>;
+
+// Fill `ts` to capacity with uniform scores; returns the next timestamp.
+template <typename Series>
+std::size_t warm_up(Series& ts, const std::size_t offset = 0) {
+    const scores uniform_scores(uniform);
+    std::size_t t = 0;
+    for (; t < ts.capacity(); ++t) {
+        ts.add(make_value<typename Series::value_type>(t), t, uniform_scores(t + offset));
+    }
+    return t;
+}
+
+// Samples per second, and samples per iteration: the time per sample is
+// the reported time divided by the latter.
+void per_sample(benchmark::State& state, const std::size_t samples) {
+    state.SetItemsProcessed(static_cast<int64_t>(samples));
+    state.counters["samples/iter"] = benchmark::Counter(static_cast<double>(samples), benchmark::Counter::kAvgIterations);
+}
+
+template <typename Series>
+void add_cold(benchmark::State& state) {
+    const auto S = static_cast<std::size_t>(state.range(0));
+    const scores score(static_cast<distribution>(state.range(1)));
+    std::size_t samples = 0;
+    for (auto _ : state) {
+        Series ts(S);
+        for (std::size_t t = 0; t < 2 * S; ++t) {
+            ts.add(make_value<typename Series::value_type>(t), t, score(t));
+        }
+        benchmark::DoNotOptimize(ts.size());
+        samples += 2 * S;
+    }
+    per_sample(state, samples);
+}
+
+template <typename Series>
+void add_warm(benchmark::State& state) {
+    const auto S = static_cast<std::size_t>(state.range(0));
+    const scores score(static_cast<distribution>(state.range(1)));
+    Series ts(S);
+    std::size_t t = warm_up(ts);
+    const auto value = make_value<typename Series::value_type>(t);
+    for (auto _ : state) {
+        ts.add(value, t, score(t));
+        ++t;
+    }
+    per_sample(state, state.iterations());
+}
+
+template <typename Series>
+void insert_late(benchmark::State& state) {
+    const auto S = static_cast<std::size_t>(state.range(0));
+    const scores score(uniform);
+    std::default_random_engine e { 1u };
+    std::uniform_int_distribution<std::size_t> lateness {0, S / 4};
+    Series ts(S);
+    std::size_t t = warm_up(ts);
+    const auto value = make_value<typename Series::value_type>(t);
+    for (auto _ : state) {
+        ts.insert(value, t - lateness(e), score(t));
+        ++t;
+    }
+    per_sample(state, state.iterations());
+}
+
+// Every late sample is accepted and lands inside the order, fit against S
+// to catch inserts that are linear in S.
+template <typename Series>
+void insert_late_scaling(benchmark::State& state) {
+    const auto S = static_cast<std::size_t>(state.range(0));
+    const scores score(improving);
+    std::default_random_engine e { 1u };
+    std::uniform_int_distribution<std::size_t> lateness {1, S / 4};
+    Series ts(S);
+    std::size_t t = warm_up(ts);
+    const auto value = make_value<typename Series::value_type>(t);
+    for (auto _ : state) {
+        ts.insert(value, t - lateness(e), score(t));
+        ++t;
+    }
+    state.SetComplexityN(static_cast<int64_t>(S));
+    per_sample(state, state.iterations());
+}
+
+// Batches of K accepted late samples through insert_range(), K on either
+// side of the size below which the batch goes in one by one.
+template <typename Series>
+void insert_batch(benchmark::State& state) {
+    const auto S = static_cast<std::size_t>(state.range(0));
+    const auto K = static_cast<std::size_t>(state.range(1));
+    const scores score(improving);
+    std::default_random_engine e { 1u };
+    std::uniform_int_distribution<std::size_t> lateness {1, S / 4};
+    Series ts(S);
+    std::size_t t = warm_up(ts);
+    std::vector<std::tuple<typename Series::value_type, std::size_t, float>> batch(K);
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (auto& [v, tm, sc] : batch) {
+            v = make_value<typename Series::value_type>(t);
+            tm = t - lateness(e);
+            sc = score(t);
+            ++t;
+        }
+        state.ResumeTiming();
+        ts.insert_range(batch.begin(), batch.end());
+    }
+    per_sample(state, state.iterations() * K);
+}
+
+template <typename Series>
+void merge(benchmark::State& state) {
+    const auto S = static_cast<std::size_t>(state.range(0));
+    Series mine(S), theirs(S);
+    warm_up(mine);
+    warm_up(theirs, 12'345);
+    for (auto _ : state) {
+        state.PauseTiming();
+        Series ts = mine;
+        state.ResumeTiming();
+        ts.merge(theirs);
+        benchmark::DoNotOptimize(ts.size());
+    }
+    per_sample(state, state.iterations() * S);
+}
+
+template <typename Series>
+void best16(benchmark::State& state) {
+    const auto S = static_cast<std::size_t>(state.range(0));
+    Series ts(S);
+    warm_up(ts);
+    for (auto _ : state) {
+        auto best = ts.template best<16>();
+        benchmark::DoNotOptimize(best);
+    }
+    per_sample(state, state.iterations());
+}
+
+template <typename Series>
+void iterate(benchmark::State& state) {
+    const auto S = static_cast<std::size_t>(state.range(0));
+    Series ts(S);
+    warm_up(ts);
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (const auto& [v, t, s] : ts) sum += t;
+        benchmark::DoNotOptimize(sum);
+    }
+    per_sample(state, state.iterations() * S);
+}
+
+// Samples from every benchmark thread into one concurrent series with a
+// shard per thread. Threads only meet the series inside the timing loop,
+// which starts and ends on a barrier, so thread 0 owns it outside.
+template <typename Concurrent>
+void concurrent_add(benchmark::State& state) {
+    static std::unique_ptr<Concurrent> ts;
+    const auto S = static_cast<std::size_t>(state.range(0));
+    const scores score(uniform);
+    if (state.thread_index() == 0) ts = std::make_unique<Concurrent>(S, static_cast<std::size_t>(state.threads()));
+    std::size_t t = static_cast<std::size_t>(state.thread_index());
+    const auto value = make_value<typename Concurrent::series_type::value_type>(t);
+    for (auto _ : state) {
+        ts->add(value, t, score(t));
+        t += static_cast<std::size_t>(state.threads());
+    }
+    if (state.thread_index() == 0) ts.reset();
+    per_sample(state, state.iterations());
+}
+
+template <typename V> const char* value_name();
+template <> const char* value_name<float>() { return "float"; }
+template <> const char* value_name<std::array<double, 8>>() { return "array<double,8>"; }
+template <> const char* value_name<blob256>() { return "blob256"; }
+
+// Every benchmark at capacity S, for a fixed or dynamic `Series`.
+template <typename Series>
+void register_capacity(const std::string& suffix, const std::size_t S) {
+    const auto s = static_cast<int64_t>(S);
+    for (int d = uniform; d <= worsening; ++d) {
+        const std::string args = "/S:" + std::to_string(S) + "/" + distribution_names[d];
+        benchmark::RegisterBenchmark(("add_cold/" + suffix + args).c_str(), add_cold<Series>)->Args({ s, d });
+        benchmark::RegisterBenchmark(("add_warm/" + suffix + args).c_str(), add_warm<Series>)->Args({ s, d });
+    }
+    const std::string args = "/S:" + std::to_string(S);
+    benchmark::RegisterBenchmark(("insert_late/" + suffix + args).c_str(), insert_late<Series>)->Arg(s);
+    if (S >= 100'000) {
+        for (const auto K : { s / 256, s / 256 + 1 }) {
+            benchmark::RegisterBenchmark(("insert_batch/" + suffix + args + "/K:" + std::to_string(K)).c_str(), insert_batch<Series>)->Args({ s, K });
+        }
+    }
+    benchmark::RegisterBenchmark(("merge/" + suffix + args).c_str(), merge<Series>)->Arg(s);
+    benchmark::RegisterBenchmark(("best16/" + suffix + args).c_str(), best16<Series>)->Arg(s);
+    benchmark::RegisterBenchmark(("iterate/" + suffix + args).c_str(), iterate<Series>)->Arg(s);
+}
+
+template <typename V, typename... Ps>
+void register_backend(const std::string& backend, const std::size_t max_S) {
+    using S_t = series<V, sts::dynamic, Ps...>;
+    const std::string suffix = backend + "/" + value_name<V>();
+    for (std::size_t S = 100; S <= max_S; S *= 10) register_capacity<S_t>(suffix, S);
+    benchmark::RegisterBenchmark(("insert_late_scaling/" + suffix).c_str(), insert_late_scaling<S_t>)
+        ->RangeMultiplier(10)->Range(100, static_cast<int64_t>(max_S))->Complexity();
+}
+
+// Small fixed capacities: std::array columns, SIMD max_position, and up to
+// 64 samples the small order.
+template <typename V, typename... Ps>
+void register_fixed(const std::string& backend) {
+    const std::string suffix = backend + "/" + value_name<V>() + "/fixed";
+    register_capacity<series<V, 16, Ps...>>(suffix, 16);
+    register_capacity<series<V, 64, Ps...>>(suffix, 64);
+    register_capacity<series<V, 256, Ps...>>(suffix, 256);
+}
+
+template <typename V, typename... Ps>
+void register_concurrent(const std::string& backend) {
+    using C_t = concurrent_selective_time_series<V, sts::dynamic, false, std::size_t, float, Ps...>;
+    const std::string suffix = backend + "/" + value_name<V>();
+    const auto threads = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+    for (const std::size_t S : { 1'000, 100'000 }) {
+        benchmark::RegisterBenchmark(("concurrent_add/" + suffix + "/S:" + std::to_string(S) + "/uniform").c_str(), concurrent_add<C_t>)
+            ->Arg(static_cast<int64_t>(S))->ThreadRange(1, threads)->UseRealTime();
+    }
+}
+
+template <typename V>
+void register_value(const std::size_t max_S) {
+    register_backend<V>("scan+dense", max_S);
+    register_backend<V, sts::worst_cached>("cached+dense", max_S);
+    register_backend<V, sts::worst_heap, sts::linked_order>("heap+linked", max_S);
+    register_backend<V, sts::worst_heap, sts::fenwick_order>("heap+fenwick", max_S);
+    register_backend<V, sts::minmax_heap, sts::fenwick_order>("minmax+fenwick", max_S);
+    register_fixed<V>("default");
+    register_fixed<V, sts::worst_cached>("cached");
+    register_fixed<V, sts::worst_heap, sts::fenwick_order>("heap+fenwick");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    register_value<float>(1'000'000);
+    register_value<std::array<double, 8>>(1'000'000);
+    register_value<blob256>(100'000); // 256 MB per series beyond that
+    register_concurrent<float>("default");
+    register_concurrent<float, sts::worst_scan, sts::dense_order>("scan+dense");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
@@ -20,11 +20,17 @@
  * 7. A `dirty` counter is incremented each time a sample without score is
  *    added. Use for partial rescoring:
  *      `for (size_t i = �.size() - �.dirty; i < �.size(); ++i) rescore(�[i]);`
- *    The user is responsible for resetting it to 0.
+ *    The user is responsible for resetting it to 0. Use `rescore(...)`, or
+ *    `reindex()` after writing scores in place.
  * 
  * Notes:
  * 1. Telling GCC by hand which branches to take (likely, etc) gains a few
  *    percent over not doing so. PGO without any indicators doubles that gain.
+ * 2. The worst sample scan is vectorized for `float`, `double` and `int`
+ *    scores if the target has AVX, AVX2, AVX-512F or AArch64 NEON.
+ * 3. Series of at most 64 samples keep their order in a byte permutation
+ *    vector by default (`sts::small_order`), which avoids the per-call loop
+ *    setup that dominates at such sizes.
  */
 
 #pragma once
@@ -33,342 +39,3693 @@
 #include <tuple>
 #include <array>
 #include <type_traits>
+#include <limits>
+#include <vector>
+#include <numeric>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <cstddef>
+#include <iterator>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+#include <compare>
+#endif
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace sts {
+/** @brief Capacity template argument for series sized at construction. */
+inline constexpr std::size_t dynamic = std::numeric_limits<std::size_t>::max();
+
+namespace detail {
+    struct score_index_category {};
+    struct order_category {};
+    struct lookup_category {};
+    struct snapshot_category {};
+    struct eviction_category {};
+    struct value_storage_category {};
+    struct top_k_category {};
+
+    /** @brief Constructor arguments for a value, see `emplace(...)`. */
+    template <typename... Args>
+    struct emplacer {
+        std::tuple<Args&&...> args;
+    };
+
+    /** @brief `dst = v`, moving if `v` is an rvalue. */
+    template <typename T, typename V>
+    constexpr void put(T& dst, V&& v) {
+        dst = std::forward<V>(v);
+    }
+
+    /** @brief Rebuild `dst` from the arguments in place if that cannot throw,
+               else move assign a temporary. */
+    template <typename T, typename... Args>
+    void put(T& dst, emplacer<Args...>&& e) {
+        if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+            std::apply([&dst](auto&&... a) {
+                dst.~T();
+                ::new (static_cast<void*>(std::addressof(dst))) T(std::forward<Args>(a)...);
+            }, std::move(e.args));
+        } else {
+            dst = std::make_from_tuple<T>(std::move(e.args));
+        }
+    }
+
+    /** @brief Whether writing `V` to a slot of `T`, by `put(...)` or
+               `construct(...)`, cannot throw. */
+    template <typename T, typename V>
+    struct nothrow_write : std::bool_constant<std::is_nothrow_constructible_v<T, V> && std::is_nothrow_assignable_v<T&, V>> {};
+    template <typename T, typename... Args>
+    struct nothrow_write<T, emplacer<Args...>> : std::bool_constant<std::is_nothrow_constructible_v<T, Args...>> {};
+
+    /** @brief A `T` built from `v`. */
+    template <typename T, typename V>
+    constexpr T make(V&& v) {
+        return T(std::forward<V>(v));
+    }
+
+    /** @brief A `T` built from the arguments. */
+    template <typename T, typename... Args>
+    T make(emplacer<Args...>&& e) {
+        return std::make_from_tuple<T>(std::move(e.args));
+    }
+
+    /** @brief Construct a `T` at `p` from `v`. */
+    template <typename T, typename V>
+    void construct(T* p, V&& v) {
+        ::new (static_cast<void*>(p)) T(std::forward<V>(v));
+    }
+
+    /** @brief Construct a `T` at `p` from the arguments. */
+    template <typename T, typename... Args>
+    void construct(T* p, emplacer<Args...>&& e) {
+        std::apply([p](auto&&... a) { ::new (static_cast<void*>(p)) T(std::forward<Args>(a)...); }, std::move(e.args));
+    }
+
+    /** @brief Relaxed atomic loads and stores of a trivially copyable
+               field, word by word. For seqlock data, which readers copy
+               while the writer may be changing it and throw away if torn. */
+    template <typename T>
+    struct relaxed {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable fields can be shared racily");
+        using word = std::conditional_t<sizeof(T) % 8 == 0 && alignof(T) >= 8, uint64_t,
+                     std::conditional_t<sizeof(T) % 4 == 0 && alignof(T) >= 4, uint32_t,
+                     std::conditional_t<sizeof(T) % 2 == 0 && alignof(T) >= 2, uint16_t, uint8_t>>>;
+        static constexpr std::size_t words = sizeof(T) / sizeof(word);
+
+        static T load(const T& x) noexcept {
+            auto* from = reinterpret_cast<word*>(const_cast<T*>(std::addressof(x)));
+            alignas(T) unsigned char raw[sizeof(T)];
+            for (std::size_t i = 0; i < words; ++i) {
+#if defined(__cpp_lib_atomic_ref)
+                const word w = std::atomic_ref<word>(from[i]).load(std::memory_order_relaxed);
+#elif defined(__GNUC__)
+                const word w = __atomic_load_n(from + i, __ATOMIC_RELAXED);
+#else
+                const word w = from[i];
+#endif
+                std::memcpy(raw + i * sizeof(word), &w, sizeof(word));
+            }
+            return *std::launder(reinterpret_cast<const T*>(raw));
+        }
+
+        static void store(T& x, const T& v) noexcept {
+            auto* to = reinterpret_cast<word*>(std::addressof(x));
+            const auto* raw = reinterpret_cast<const unsigned char*>(std::addressof(v));
+            for (std::size_t i = 0; i < words; ++i) {
+                word w;
+                std::memcpy(&w, raw + i * sizeof(word), sizeof(word));
+#if defined(__cpp_lib_atomic_ref)
+                std::atomic_ref<word>(to[i]).store(w, std::memory_order_relaxed);
+#elif defined(__GNUC__)
+                __atomic_store_n(to + i, w, __ATOMIC_RELAXED);
+#else
+                to[i] = w;
+#endif
+            }
+        }
+    };
+
+    /** @brief Eviction sink that ignores evicted samples. */
+    struct discard {
+        template <typename V, typename T, typename Sc>
+        constexpr void operator()(V&, const T&, const Sc&) const noexcept {}
+    };
+    struct allocator_category {};
+
+    /** @brief Extent `S * Mul + Add`, or `dynamic` if `S` is. */
+    template <std::size_t S, std::size_t Mul, std::size_t Add = 0>
+    inline constexpr std::size_t scaled = S == dynamic ? dynamic : S * Mul + Add;
+
+    constexpr std::size_t ceil_pow2(std::size_t n) noexcept {
+        std::size_t p = 1;
+        while (p < n) p *= 2;
+        return p;
+    }
+
+    /** @brief Fixed size storage: a plain `std::array`, sizes given at
+               construction are ignored. */
+    template <typename T, std::size_t N, typename Alloc>
+    class column {
+    public:
+        static constexpr bool deferred = false;
+
+        constexpr column(std::size_t, const Alloc&) noexcept {}
+
+        constexpr T*       data()       noexcept { return a.data(); }
+        constexpr const T* data() const noexcept { return a.data(); }
+        constexpr T*       begin()       noexcept { return a.data(); }
+        constexpr const T* begin() const noexcept { return a.data(); }
+        constexpr T*       end()       noexcept { return a.data() + N; }
+        constexpr const T* end() const noexcept { return a.data() + N; }
+        constexpr std::size_t size() const noexcept { return N; }
+        constexpr T&       operator[](std::size_t i)       noexcept { return a[i]; }
+        constexpr const T& operator[](std::size_t i) const noexcept { return a[i]; }
+        constexpr void fill(const T& v) noexcept { a.fill(v); }
+    private:
+        std::array<T, N> a;
+    };
+
+    /** @brief Runtime sized storage, allocated once through `Alloc`. */
+    template <typename T, typename Alloc>
+    class column<T, dynamic, Alloc> {
+        using alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using traits = std::allocator_traits<alloc_t>;
+    public:
+        static constexpr bool deferred = false;
+
+        column(std::size_t size, const Alloc& a) : alloc(a), n{size} {
+            p = traits::allocate(alloc, n);
+            for (std::size_t i = 0; i < n; ++i) traits::construct(alloc, p + i);
+        }
+        column(const column& other)
+            : alloc(traits::select_on_container_copy_construction(other.alloc)), n{other.n} {
+            p = traits::allocate(alloc, n);
+            for (std::size_t i = 0; i < n; ++i) traits::construct(alloc, p + i, other.p[i]);
+        }
+        column(column&& other) noexcept : alloc(std::move(other.alloc)), p{other.p}, n{other.n} {
+            other.p = nullptr;
+            other.n = 0;
+        }
+        column& operator=(const column& other) {
+            if (this != &other) {
+                column copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+        column& operator=(column&& other) noexcept {
+            swap(other);
+            return *this;
+        }
+        ~column() {
+            if (!p) return;
+            for (std::size_t i = 0; i < n; ++i) traits::destroy(alloc, p + i);
+            traits::deallocate(alloc, p, n);
+        }
+        void swap(column& other) noexcept {
+            using std::swap;
+            swap(alloc, other.alloc);
+            swap(p, other.p);
+            swap(n, other.n);
+        }
+
+        T*       data()       noexcept { return p; }
+        const T* data() const noexcept { return p; }
+        T*       begin()       noexcept { return p; }
+        const T* begin() const noexcept { return p; }
+        T*       end()       noexcept { return p + n; }
+        const T* end() const noexcept { return p + n; }
+        std::size_t size() const noexcept { return n; }
+        T&       operator[](std::size_t i)       noexcept { return p[i]; }
+        const T& operator[](std::size_t i) const noexcept { return p[i]; }
+        void fill(const T& v) noexcept { std::fill(p, p + n, v); }
+    private:
+        alloc_t alloc;
+        T* p {nullptr};
+        std::size_t n {0};
+    };
+
+    /**
+     * @brief Value storage outside the series object, allocated once through
+     * `Alloc`. Slots are constructed on their first write only, in order, so
+     * unused capacity costs no construction and copies only touch used slots.
+     */
+    template <typename T, typename Alloc>
+    class value_slab {
+        using alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using traits = std::allocator_traits<alloc_t>;
+    public:
+        static constexpr bool deferred = true;
+
+        value_slab(std::size_t size, const Alloc& a) : alloc(a), cap{size} {
+            p = traits::allocate(alloc, cap);
+        }
+        value_slab(const value_slab& other)
+            : alloc(traits::select_on_container_copy_construction(other.alloc)), cap{other.cap} {
+            p = traits::allocate(alloc, cap);
+            for (; n < other.n; ++n) traits::construct(alloc, p + n, other.p[n]);
+        }
+        /** @brief Leaves `other` empty, allocating again on its next write. */
+        value_slab(value_slab&& other) noexcept : alloc(other.alloc), p{other.p}, cap{other.cap}, n{other.n} {
+            other.p = nullptr;
+            other.n = 0;
+        }
+        value_slab& operator=(const value_slab& other) {
+            if (this != &other) {
+                value_slab copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+        value_slab& operator=(value_slab&& other) noexcept {
+            value_slab taken(std::move(other));
+            swap(taken);
+            return *this;
+        }
+        ~value_slab() {
+            if (!p) return;
+            for (std::size_t i = 0; i < n; ++i) traits::destroy(alloc, p + i);
+            traits::deallocate(alloc, p, cap);
+        }
+        void swap(value_slab& other) noexcept {
+            using std::swap;
+            swap(alloc, other.alloc);
+            swap(p, other.p);
+            swap(cap, other.cap);
+            swap(n, other.n);
+        }
+
+        /** @brief Write slot `i`, constructing it if `fresh` (then `i` is
+                   the first unconstructed slot). */
+        template <typename V>
+        void write(std::size_t i, bool fresh, V&& v) {
+            if (fresh) {
+                if (!p) p = traits::allocate(alloc, cap);
+                construct(p + i, std::forward<V>(v));
+                ++n;
+            } else {
+                put(p[i], std::forward<V>(v));
+            }
+        }
+
+        T*       data()       noexcept { return p; }
+        const T* data() const noexcept { return p; }
+        T&       operator[](std::size_t i)       noexcept { return p[i]; }
+        const T& operator[](std::size_t i) const noexcept { return p[i]; }
+    private:
+        alloc_t alloc;
+        T* p {nullptr};
+        std::size_t cap {0};
+        std::size_t n {0}; // Constructed slots
+    };
+
+    /** @brief Capacity of a series, only stored if `dynamic`. */
+    template <std::size_t S>
+    struct extent {
+        constexpr explicit extent(std::size_t) noexcept {}
+        constexpr std::size_t capacity() const noexcept { return S; }
+        constexpr void release() noexcept {}
+    };
+    template <>
+    struct extent<dynamic> {
+        constexpr explicit extent(std::size_t c) noexcept : cap{c} {}
+        constexpr std::size_t capacity() const noexcept { return cap; }
+        /** @brief The columns were moved out, nothing can be stored. */
+        constexpr void release() noexcept { cap = 0; }
+    private:
+        std::size_t cap;
+    };
+
+    /** @brief Smallest unsigned type that holds `N`. */
+    template <std::size_t N>
+    using uint_for = std::conditional_t<(N < 256),
+                                        uint8_t,
+                                        std::conditional_t<(N < 65536),
+                                                           uint16_t,
+                                                           std::conditional_t<(N < 4294967296),
+                                                                              uint32_t, uint64_t>>>;
+
+    /** @brief Pick the policy of `Category` from `Ps...`, or `Default`. */
+    template <typename Category, typename Default, typename... Ps>
+    struct select_policy {
+        using type = Default;
+    };
+    template <typename Category, typename Default, typename P, typename... Ps>
+    struct select_policy<Category, Default, P, Ps...> {
+        using type = std::conditional_t<std::is_same_v<typename P::category, Category>,
+                                        P,
+                                        typename select_policy<Category, Default, Ps...>::type>;
+    };
+
+    /**
+     * @brief Strict ordering used by all score indices: `a` is worse than `b`
+     * if it scores higher, or scores equal and lives in a lower slot. The
+     * latter keeps eviction identical to a `std::max_element` scan.
+     */
+    template <typename index_t, typename T_score>
+    constexpr bool worse(const T_score* scores, index_t a, index_t b) noexcept {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    }
+
+    /**
+     * @brief SIMD lanes for `T`, picked at compile time from the target
+     * (`-mavx512f`, `-mavx2`/`-mavx`, AArch64 NEON). `width == 0` means no
+     * vector path for `T`.
+     */
+    template <typename T>
+    struct simd {
+        static constexpr std::size_t width = 0;
+    };
+#if defined(__AVX512F__)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// _mm512_undefined_*() inside GCC's own intrinsics, e.g. _mm512_reduce_max_ps()
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+    template <>
+    struct simd<float> {
+        static constexpr std::size_t width = 16;
+        using reg = __m512;
+        static reg load(const float* p) noexcept { return _mm512_loadu_ps(p); }
+        static reg max(reg a, reg b) noexcept { return _mm512_max_ps(a, b); }
+        static float hmax(reg a) noexcept { return _mm512_reduce_max_ps(a); }
+        static bool any_eq(reg a, float v) noexcept { return _mm512_cmp_ps_mask(a, _mm512_set1_ps(v), _CMP_EQ_OQ) != 0; }
+    };
+    template <>
+    struct simd<double> {
+        static constexpr std::size_t width = 8;
+        using reg = __m512d;
+        static reg load(const double* p) noexcept { return _mm512_loadu_pd(p); }
+        static reg max(reg a, reg b) noexcept { return _mm512_max_pd(a, b); }
+        static double hmax(reg a) noexcept { return _mm512_reduce_max_pd(a); }
+        static bool any_eq(reg a, double v) noexcept { return _mm512_cmp_pd_mask(a, _mm512_set1_pd(v), _CMP_EQ_OQ) != 0; }
+    };
+    template <>
+    struct simd<std::int32_t> {
+        static constexpr std::size_t width = 16;
+        using reg = __m512i;
+        static reg load(const std::int32_t* p) noexcept { return _mm512_loadu_si512(p); }
+        static reg max(reg a, reg b) noexcept { return _mm512_max_epi32(a, b); }
+        static std::int32_t hmax(reg a) noexcept { return _mm512_reduce_max_epi32(a); }
+        static bool any_eq(reg a, std::int32_t v) noexcept { return _mm512_cmpeq_epi32_mask(a, _mm512_set1_epi32(v)) != 0; }
+    };
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#elif defined(__AVX__)
+    template <>
+    struct simd<float> {
+        static constexpr std::size_t width = 8;
+        using reg = __m256;
+        static reg load(const float* p) noexcept { return _mm256_loadu_ps(p); }
+        static reg max(reg a, reg b) noexcept { return _mm256_max_ps(a, b); }
+        static float hmax(reg a) noexcept {
+            __m128 m = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+            m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+            return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, 1)));
+        }
+        static bool any_eq(reg a, float v) noexcept { return _mm256_movemask_ps(_mm256_cmp_ps(a, _mm256_set1_ps(v), _CMP_EQ_OQ)) != 0; }
+    };
+    template <>
+    struct simd<double> {
+        static constexpr std::size_t width = 4;
+        using reg = __m256d;
+        static reg load(const double* p) noexcept { return _mm256_loadu_pd(p); }
+        static reg max(reg a, reg b) noexcept { return _mm256_max_pd(a, b); }
+        static double hmax(reg a) noexcept {
+            const __m128d m = _mm_max_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+            return _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+        }
+        static bool any_eq(reg a, double v) noexcept { return _mm256_movemask_pd(_mm256_cmp_pd(a, _mm256_set1_pd(v), _CMP_EQ_OQ)) != 0; }
+    };
+#if defined(__AVX2__)
+    template <>
+    struct simd<std::int32_t> {
+        static constexpr std::size_t width = 8;
+        using reg = __m256i;
+        static reg load(const std::int32_t* p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static reg max(reg a, reg b) noexcept { return _mm256_max_epi32(a, b); }
+        static std::int32_t hmax(reg a) noexcept {
+            __m128i m = _mm_max_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+            m = _mm_max_epi32(m, _mm_shuffle_epi32(m, 0x4E));
+            return _mm_cvtsi128_si32(_mm_max_epi32(m, _mm_shuffle_epi32(m, 0xB1)));
+        }
+        static bool any_eq(reg a, std::int32_t v) noexcept { return _mm256_movemask_epi8(_mm256_cmpeq_epi32(a, _mm256_set1_epi32(v))) != 0; }
+    };
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    template <>
+    struct simd<float> {
+        static constexpr std::size_t width = 4;
+        using reg = float32x4_t;
+        static reg load(const float* p) noexcept { return vld1q_f32(p); }
+        static reg max(reg a, reg b) noexcept { return vmaxq_f32(a, b); }
+        static float hmax(reg a) noexcept { return vmaxvq_f32(a); }
+        static bool any_eq(reg a, float v) noexcept { return vmaxvq_u32(vceqq_f32(a, vdupq_n_f32(v))) != 0; }
+    };
+    template <>
+    struct simd<double> {
+        static constexpr std::size_t width = 2;
+        using reg = float64x2_t;
+        static reg load(const double* p) noexcept { return vld1q_f64(p); }
+        static reg max(reg a, reg b) noexcept { return vmaxq_f64(a, b); }
+        static double hmax(reg a) noexcept { return vmaxvq_f64(a); }
+        static bool any_eq(reg a, double v) noexcept { return vmaxvq_u32(vreinterpretq_u32_u64(vceqq_f64(a, vdupq_n_f64(v)))) != 0; }
+    };
+    template <>
+    struct simd<std::int32_t> {
+        static constexpr std::size_t width = 4;
+        using reg = int32x4_t;
+        static reg load(const std::int32_t* p) noexcept { return vld1q_s32(p); }
+        static reg max(reg a, reg b) noexcept { return vmaxq_s32(a, b); }
+        static std::int32_t hmax(reg a) noexcept { return vmaxvq_s32(a); }
+        static bool any_eq(reg a, std::int32_t v) noexcept { return vmaxvq_u32(vceqq_s32(a, vdupq_n_s32(v))) != 0; }
+    };
+#endif
+
+    /**
+     * @brief Position of the first maximum in `p[0..n)`, same as
+     * `std::max_element`. Vectorized in two passes: reduce to the maximum,
+     * then find the first block holding it. Scores must not be NaN. `N` is
+     * an upper bound of `n`, if known at compile time. Any `n` of at least
+     * one vector is covered without a scalar loop over the tail, a smaller
+     * `N` with one padded vector.
+     */
+    template <std::size_t N = dynamic, typename T>
+    inline std::size_t max_position(const T* p, const std::size_t n) noexcept {
+        using V = simd<T>;
+        if constexpr (V::width > 0 && N >= V::width) {
+            constexpr std::size_t W = V::width;
+            if (n >= W) {
+                auto acc = V::load(p);
+                std::size_t i = W;
+                for (; i + W <= n; i += W) acc = V::max(acc, V::load(p + i));
+                // Overlapping last block instead of a scalar tail
+                if (i < n) acc = V::max(acc, V::load(p + n - W));
+                const T m = V::hmax(acc);
+
+                i = 0;
+                while (i + W <= n && !V::any_eq(V::load(p + i), m)) i += W;
+                while (p[i] != m) ++i;
+                return i;
+            }
+        }
+        if constexpr (V::width > 0 && N > 1 && N < V::width) {
+            if (n > 0) {
+                // Shorter than a vector: pad with a copy of `p[0]`, which
+                // changes neither the maximum nor its first position
+                std::array<T, V::width> padded;
+                padded.fill(p[0]);
+                std::copy(p, p + n, padded.begin());
+                const T m = V::hmax(V::load(padded.data()));
+                std::size_t i = 0;
+                while (p[i] != m) ++i;
+                return i;
+            }
+        }
+        return static_cast<std::size_t>(std::distance(p, std::max_element(p, p + n)));
+    }
+
+    /** @brief Index of the lowest set bit of a non-zero `m`. */
+    inline std::size_t first_bit(uint64_t m) noexcept {
+#if defined(__GNUC__)
+        return static_cast<std::size_t>(__builtin_ctzll(m));
+#else
+        std::size_t i = 0;
+        while (!(m & 1)) { m >>= 1; ++i; }
+        return i;
+#endif
+    }
+
+    /**
+     * @brief Bit `i` is set if `p[i] == v`, for `i < B`. `B` is 16, 32 or 64,
+     * so this is one to four 16 byte compares, or a scalar loop without SSE2
+     * or NEON.
+     */
+    template <std::size_t B>
+    inline uint64_t match_bytes(const uint8_t* p, const uint8_t v) noexcept {
+        static_assert(B % 16 == 0 && B <= 64, "Byte match covers up to four 16 byte blocks");
+        uint64_t m = 0;
+#if defined(__SSE2__)
+        const __m128i x = _mm_set1_epi8(static_cast<char>(v));
+        for (std::size_t i = 0; i < B; i += 16) {
+            const __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), x);
+            m |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(eq))} << i;
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const uint8x16_t x = vdupq_n_u8(v);
+        const uint8x16_t bits = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+        for (std::size_t i = 0; i < B; i += 16) {
+            const uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(p + i), x), bits);
+            m |= (uint64_t{vaddv_u8(vget_low_u8(eq))} | uint64_t{vaddv_u8(vget_high_u8(eq))} << 8) << i;
+        }
+#else
+        for (std::size_t i = 0; i < B; ++i) m |= uint64_t{p[i] == v} << i;
+#endif
+        return m;
+    }
+
+    /** @brief `p[i] = p[i + 1]` for `r <= i < B`, `p` holds `B + 1` bytes. */
+    template <std::size_t B>
+    inline void shift_down(uint8_t* p, const std::size_t r) noexcept {
+#if defined(__SSE2__)
+        const __m128i lane = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        for (std::size_t i = 0; i < B; i += 16) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 1));
+            const __m128i m = _mm_cmpgt_epi8(_mm_add_epi8(lane, _mm_set1_epi8(static_cast<char>(i))), _mm_set1_epi8(static_cast<char>(r - 1)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const uint8x16_t lane = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+        for (std::size_t i = 0; i < B; i += 16) {
+            const uint8x16_t m = vcgeq_u8(vaddq_u8(lane, vdupq_n_u8(static_cast<uint8_t>(i))), vdupq_n_u8(static_cast<uint8_t>(r)));
+            vst1q_u8(p + i, vbslq_u8(m, vld1q_u8(p + i + 1), vld1q_u8(p + i)));
+        }
+#else
+        if (r < B) std::move(p + r + 1, p + B + 1, p + r);
+#endif
+    }
+
+    /** @brief `p[i] = p[i - 1]` for `r < i < B`. */
+    template <std::size_t B>
+    inline void shift_up(uint8_t* p, const std::size_t r) noexcept {
+#if defined(__SSE2__)
+        const __m128i lane = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        for (std::size_t i = B; i > 0;) {
+            i -= 16;
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const __m128i b = i ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i - 1)) : _mm_slli_si128(a, 1);
+            const __m128i m = _mm_cmpgt_epi8(_mm_add_epi8(lane, _mm_set1_epi8(static_cast<char>(i))), _mm_set1_epi8(static_cast<char>(r)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const uint8x16_t lane = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+        for (std::size_t i = B; i > 0;) {
+            i -= 16;
+            const uint8x16_t a = vld1q_u8(p + i);
+            const uint8x16_t b = i ? vld1q_u8(p + i - 1) : vextq_u8(vdupq_n_u8(0), a, 15);
+            const uint8x16_t m = vcgtq_u8(vaddq_u8(lane, vdupq_n_u8(static_cast<uint8_t>(i))), vdupq_n_u8(static_cast<uint8_t>(r)));
+            vst1q_u8(p + i, vbslq_u8(m, b, a));
+        }
+#else
+        if (r + 1 < B) std::move_backward(p + r, p + B - 1, p + B);
+#endif
+    }
+
+    /**
+     * @brief Linear scan over the utilized scores. With `Cache` the worst
+     * slot is remembered, so a stream of rejected samples costs one compare
+     * each and a scan is only needed after the cached worst itself improves;
+     * scores written in place then need a `reindex()`.
+     */
+    template <typename index_t, std::size_t S, typename T_score, typename Alloc, bool Cache>
+    struct scan_index {
+        static constexpr bool has_best = false;
+        static constexpr bool logarithmic = false;
+
+        mutable index_t cached {0};
+        mutable T_score cached_score {};
+        mutable bool valid {false};
+
+        constexpr scan_index(std::size_t, const Alloc&) noexcept {}
+
+        constexpr void push(index_t slot, const T_score* scores) noexcept {
+            if (Cache && valid && worse(scores, slot, cached)) {
+                cached = slot;
+                cached_score = scores[slot];
+            }
+        }
+
+        constexpr void update(index_t slot, const T_score* scores) noexcept {
+            if (!Cache || !valid) return;
+            if (slot == cached) {
+                if (scores[slot] >= cached_score) {
+                    cached_score = scores[slot];
+                } else {
+                    valid = false;
+                }
+            } else {
+                push(slot, scores);
+            }
+        }
+
+        constexpr void rebuild(const T_score*, index_t) noexcept { valid = false; }
+
+        constexpr index_t worst(const T_score* scores, index_t n) const noexcept {
+            if constexpr (!Cache) {
+                return static_cast<index_t>(max_position<S>(scores, n));
+            } else {
+                if (!valid && n > 0) {
+                    cached = static_cast<index_t>(max_position<S>(scores, n));
+                    cached_score = scores[cached];
+                    valid = true;
+                }
+                return cached;
+            }
+        }
+    };
+
+    /** @brief Binary max-heap over slot indices, with a slot -> heap position map. */
+    template <typename index_t, std::size_t S, typename T_score, typename Alloc>
+    struct heap_index {
+        static constexpr bool has_best = false;
+        static constexpr bool logarithmic = true;
+
+        column<index_t, S, Alloc> heap;
+        column<index_t, S, Alloc> pos;
+        index_t size {0};
+
+        constexpr heap_index(std::size_t capacity, const Alloc& alloc) : heap(capacity, alloc), pos(capacity, alloc) {}
+
+        constexpr void place(index_t i, index_t slot) noexcept {
+            heap[i] = slot;
+            pos[slot] = i;
+        }
+
+        constexpr void sift_up(index_t i, const T_score* scores) noexcept {
+            const index_t slot = heap[i];
+            while (i > 0) {
+                const index_t parent = (i - 1) / 2;
+                if (!worse(scores, slot, heap[parent])) break;
+                place(i, heap[parent]);
+                i = parent;
+            }
+            place(i, slot);
+        }
+
+        constexpr void sift_down(index_t i, const T_score* scores) noexcept {
+            const index_t slot = heap[i];
+            for (;;) {
+                std::size_t child = 2 * static_cast<std::size_t>(i) + 1;
+                if (child >= size) break;
+                if (child + 1 < size && worse(scores, heap[child + 1], heap[child])) ++child;
+                if (!worse(scores, heap[child], slot)) break;
+                place(i, heap[child]);
+                i = static_cast<index_t>(child);
+            }
+            place(i, slot);
+        }
+
+        /** @brief Register newly occupied `slot`. */
+        constexpr void push(index_t slot, const T_score* scores) noexcept {
+            heap[size] = slot;
+            pos[slot] = size;
+            sift_up(size++, scores);
+        }
+
+        /** @brief Restore the heap after `scores[slot]` changed, either way. */
+        constexpr void update(index_t slot, const T_score* scores) noexcept {
+            const index_t i = pos[slot];
+            sift_up(i, scores);
+            sift_down(pos[slot], scores);
+        }
+
+        /** @brief Rebuild from slots `0..n-1` in O(n). */
+        constexpr void rebuild(const T_score* scores, index_t n) noexcept {
+            size = n;
+            for (index_t i = 0; i < n; ++i) place(i, i);
+            for (index_t i = n / 2; i-- > 0;) sift_down(i, scores);
+        }
+
+        constexpr index_t worst(const T_score*, index_t) const noexcept {
+            return size ? heap[0] : 0;
+        }
+    };
+
+    /**
+     * @brief Min-max heap over slot indices, with a slot -> heap position map.
+     * Even levels hold slots better than everything below them, odd levels
+     * worse ones, so the best slot is the root and the worst one of its two
+     * children: both O(1), updates O(log S).
+     */
+    template <typename index_t, std::size_t S, typename T_score, typename Alloc>
+    struct minmax_heap_index {
+        static constexpr bool has_best = true;
+        static constexpr bool logarithmic = true;
+
+        column<index_t, S, Alloc> heap;
+        column<index_t, S, Alloc> pos;
+        index_t size {0};
+
+        constexpr minmax_heap_index(std::size_t capacity, const Alloc& alloc) : heap(capacity, alloc), pos(capacity, alloc) {}
+
+        static constexpr bool min_level(std::size_t i) noexcept {
+            bool even = true;
+            for (++i; i > 1; i >>= 1) even = !even;
+            return even;
+        }
+
+        /** @brief Whether `a` belongs above `b` on a level of kind `min`. */
+        static constexpr bool above(const T_score* scores, index_t a, index_t b, bool min) noexcept {
+            return min ? worse(scores, b, a) : worse(scores, a, b);
+        }
+
+        constexpr void place(std::size_t i, index_t slot) noexcept {
+            heap[i] = slot;
+            pos[slot] = static_cast<index_t>(i);
+        }
+
+        constexpr void swap(std::size_t i, std::size_t j) noexcept {
+            const index_t a = heap[i];
+            place(i, heap[j]);
+            place(j, a);
+        }
+
+        /** @brief Move `heap[i]` up along the levels of its own kind. Returns
+                   whether it moved. */
+        constexpr bool bubble_up(std::size_t i, const T_score* scores) noexcept {
+            const bool min = min_level(i);
+            const std::size_t start = i;
+            while (i > 2 && above(scores, heap[i], heap[(i - 3) / 4], min)) {
+                swap(i, (i - 3) / 4);
+                i = (i - 3) / 4;
+            }
+            return i != start;
+        }
+
+        constexpr void trickle_down(std::size_t i, const T_score* scores) noexcept {
+            const bool min = min_level(i);
+            for (;;) {
+                const std::size_t first = 2 * i + 1;
+                if (first >= size) return;
+                // Most extreme of the children and grandchildren
+                std::size_t m = first;
+                if (first + 1 < size && above(scores, heap[first + 1], heap[m], min)) m = first + 1;
+                for (std::size_t g = 2 * first + 1; g < 2 * first + 5 && g < size; ++g) {
+                    if (above(scores, heap[g], heap[m], min)) m = g;
+                }
+                if (!above(scores, heap[m], heap[i], min)) return;
+                swap(m, i);
+                if (m <= first + 1) return;
+                const std::size_t parent = (m - 1) / 2;
+                if (above(scores, heap[parent], heap[m], min)) swap(m, parent);
+                i = m;
+            }
+        }
+
+        /** @brief Restore the heap around position `i`, whose slot changed
+                   score either way. The rest of the heap must be valid. */
+        constexpr void fix(std::size_t i, const T_score* scores) noexcept {
+            if (i > 0) {
+                const std::size_t parent = (i - 1) / 2;
+                if (above(scores, heap[i], heap[parent], !min_level(i))) {
+                    // Belongs on the other kind of level: the parent's slot
+                    // comes down and still bounds this subtree from the
+                    // other side
+                    swap(i, parent);
+                    bubble_up(parent, scores);
+                    trickle_down(i, scores);
+                    return;
+                }
+            }
+            if (!bubble_up(i, scores)) trickle_down(i, scores);
+        }
+
+        /** @brief Register newly occupied `slot`. */
+        constexpr void push(index_t slot, const T_score* scores) noexcept {
+            place(size, slot);
+            fix(size++, scores);
+        }
+
+        /** @brief Restore the heap after `scores[slot]` changed, either way. */
+        constexpr void update(index_t slot, const T_score* scores) noexcept {
+            fix(pos[slot], scores);
+        }
+
+        /** @brief Rebuild from slots `0..n-1` in O(n). */
+        constexpr void rebuild(const T_score* scores, index_t n) noexcept {
+            size = n;
+            for (index_t i = 0; i < n; ++i) place(i, i);
+            for (index_t i = n / 2; i-- > 0;) trickle_down(i, scores);
+        }
+
+        constexpr index_t best(const T_score*, index_t) const noexcept {
+            return size ? heap[0] : 0;
+        }
+
+        constexpr index_t worst(const T_score* scores, index_t) const noexcept {
+            if (size < 3) return size ? heap[size - 1] : 0;
+            return worse(scores, heap[1], heap[2]) ? heap[1] : heap[2];
+        }
+    };
+
+    /*
+     * Order backends keep the chronological (oldest first) sequence of
+     * occupied slots. `n` is always the amount of slots in the sequence
+     * before the call. Cursors walk the sequence without repeated lookups.
+     * `late_insert` tells whether inserting close to the newest sample is
+     * sublinear in S.
+     */
+
+    /** @brief Dense array of slots in chronological order. */
+    template <typename index_t, std::size_t S, typename Alloc>
+    struct dense_order {
+        using cursor = index_t;
+        static constexpr bool random_access = true;
+        static constexpr bool late_insert = false;
+
+        column<index_t, S, Alloc> offsets;
+
+        constexpr dense_order(std::size_t capacity, const Alloc& alloc) : offsets(capacity, alloc) {}
+
+        constexpr index_t at(index_t rank, index_t) const noexcept { return offsets[rank]; }
+
+        constexpr index_t find(index_t slot, index_t n) const noexcept {
+            for (index_t i = 0; i < n; ++i) {
+                if (offsets[i] == slot) return i;
+            }
+            return n;
+        }
+
+        constexpr void append(index_t slot, index_t n) noexcept { offsets[n] = slot; }
+
+        constexpr void move_to_back(index_t slot, index_t n) noexcept {
+            const auto r = find(slot, n);
+            // std::rotate generates a huge amount of extra assembly,
+            // something fishy going on there.
+            std::move(offsets.begin() + r + 1, offsets.begin() + n, offsets.begin() + r);
+            offsets[n - 1] = slot;
+        }
+
+        constexpr void insert(index_t slot, index_t rank, index_t n) noexcept {
+            std::move_backward(offsets.begin() + rank, offsets.begin() + n, offsets.begin() + n + 1);
+            offsets[rank] = slot;
+        }
+
+        /** @brief Move `slot` so it ends up at `rank` of the sequence without it. */
+        constexpr void relocate(index_t slot, index_t rank, index_t n) noexcept {
+            const auto r = find(slot, n);
+            if (rank < r) {
+                std::move_backward(offsets.begin() + rank, offsets.begin() + r, offsets.begin() + r + 1);
+            } else if (r < rank) {
+                std::move(offsets.begin() + r + 1, offsets.begin() + rank + 1, offsets.begin() + r);
+            }
+            offsets[rank] = slot;
+        }
+
+        /** @brief Replace the sequence by `n` slots, oldest first. */
+        constexpr void assign(const index_t* seq, index_t n) noexcept {
+            std::copy(seq, seq + n, offsets.begin());
+        }
+
+        constexpr cursor seek(index_t rank, index_t) const noexcept { return rank; }
+        constexpr cursor next(cursor c) const noexcept { return c + 1; }
+        constexpr cursor prev(cursor c) const noexcept { return c - 1; }
+        constexpr index_t slot(cursor c) const noexcept { return offsets[c]; }
+    };
+
+    /**
+     * @brief Permutation vector of at most 64 one-byte slots, padded to a
+     * whole number of 16 byte blocks with `nil`. Finding a slot is a byte
+     * compare and a bit scan, shifting a blend per block: no loops depending
+     * on `n`.
+     */
+    template <typename index_t, std::size_t S, typename Alloc>
+    struct small_order {
+        static_assert(S <= 64 && sizeof(index_t) == 1, "sts::small_order holds at most 64 samples");
+        using cursor = index_t;
+        static constexpr bool random_access = true;
+        static constexpr bool late_insert = false;
+        static constexpr std::size_t B = S <= 16 ? 16 : S <= 32 ? 32 : 64;
+        static constexpr uint8_t nil = 0xFF;
+
+        // One spare `nil` past the end, read when shifting down
+        alignas(16) std::array<uint8_t, B + 1> offsets;
+
+        constexpr small_order(std::size_t, const Alloc&) noexcept { offsets.fill(nil); }
+
+        constexpr index_t at(index_t rank, index_t) const noexcept { return offsets[rank]; }
+
+        constexpr std::size_t find(index_t slot) const noexcept {
+            return first_bit(match_bytes<B>(offsets.data(), slot));
+        }
+
+        /** @brief Put `slot` at rank `r`, moving later slots up. */
+        constexpr void insert_at(index_t slot, std::size_t r) noexcept {
+            shift_up<B>(offsets.data(), r);
+            offsets[r] = slot;
+        }
+
+        constexpr void append(index_t slot, index_t n) noexcept { offsets[n] = slot; }
+
+        constexpr void move_to_back(index_t slot, index_t n) noexcept {
+            shift_down<B>(offsets.data(), find(slot));
+            offsets[n - 1] = slot;
+        }
+
+        constexpr void insert(index_t slot, index_t rank, index_t) noexcept { insert_at(slot, rank); }
+
+        constexpr void relocate(index_t slot, index_t rank, index_t) noexcept {
+            shift_down<B>(offsets.data(), find(slot));
+            insert_at(slot, rank);
+        }
+
+        constexpr void assign(const index_t* seq, index_t n) noexcept {
+            offsets.fill(nil);
+            std::copy(seq, seq + n, offsets.begin());
+        }
+
+        constexpr cursor seek(index_t rank, index_t) const noexcept { return rank; }
+        constexpr cursor next(cursor c) const noexcept { return c + 1; }
+        constexpr cursor prev(cursor c) const noexcept { return c - 1; }
+        constexpr index_t slot(cursor c) const noexcept { return offsets[c]; }
+    };
+
+    /** @brief Doubly linked list over slots: O(1) unlink and append. */
+    template <typename index_t, std::size_t S, typename Alloc>
+    struct linked_order {
+        using cursor = index_t;
+        static constexpr bool random_access = false;
+        static constexpr bool late_insert = false; // Walks from the nearest end
+        static constexpr index_t nil = std::numeric_limits<index_t>::max();
+
+        column<index_t, S, Alloc> prevs;
+        column<index_t, S, Alloc> nexts;
+        index_t head {nil};
+        index_t tail {nil};
+
+        constexpr linked_order(std::size_t capacity, const Alloc& alloc) : prevs(capacity, alloc), nexts(capacity, alloc) {}
+
+        constexpr index_t at(index_t rank, index_t n) const noexcept { return seek(rank, n); }
+
+        constexpr void unlink(index_t slot) noexcept {
+            const index_t p = prevs[slot], q = nexts[slot];
+            (p == nil ? head : nexts[p]) = q;
+            (q == nil ? tail : prevs[q]) = p;
+        }
+
+        constexpr void link_before(index_t slot, index_t before) noexcept {
+            const index_t p = before == nil ? tail : prevs[before];
+            prevs[slot] = p;
+            nexts[slot] = before;
+            (p == nil ? head : nexts[p]) = slot;
+            (before == nil ? tail : prevs[before]) = slot;
+        }
+
+        constexpr void append(index_t slot, index_t) noexcept { link_before(slot, nil); }
+
+        constexpr void move_to_back(index_t slot, index_t) noexcept {
+            if (slot == tail) return;
+            unlink(slot);
+            link_before(slot, nil);
+        }
+
+        constexpr void insert(index_t slot, index_t rank, index_t n) noexcept {
+            link_before(slot, seek(rank, n));
+        }
+
+        constexpr void relocate(index_t slot, index_t rank, index_t n) noexcept {
+            unlink(slot);
+            insert(slot, rank, n - 1);
+        }
+
+        constexpr void assign(const index_t* seq, index_t n) noexcept {
+            head = tail = nil;
+            for (index_t i = 0; i < n; ++i) link_before(seq[i], nil);
+        }
+
+        /** @brief Walk from the nearest end, `nil` if `rank` is out of range. */
+        constexpr cursor seek(index_t rank, index_t n) const noexcept {
+            if (rank >= n) return nil;
+            index_t c;
+            if (rank < n / 2) {
+                c = head;
+                for (index_t i = 0; i < rank; ++i) c = nexts[c];
+            } else {
+                c = tail;
+                for (index_t i = n - 1; i > rank; --i) c = prevs[c];
+            }
+            return c;
+        }
+        constexpr cursor next(cursor c) const noexcept { return nexts[c]; }
+        constexpr cursor prev(cursor c) const noexcept { return prevs[c]; }
+        constexpr index_t slot(cursor c) const noexcept { return c; }
+    };
+
+    /**
+     * @brief Slots placed on a timeline of 2S positions, with a Fenwick tree
+     * counting occupied positions. Eviction leaves a hole, appends go to the
+     * end of the timeline, which is compacted once every S/2 appends or so.
+     * A late insert shifts the samples up to the nearest hole; when there is
+     * none close by, the smallest aligned window around it that is sparse
+     * enough is spread out first, as in a packed memory array. Rank lookups
+     * descend the tree in O(log S), inserts are amortized O(log^2 S).
+     */
+    template <typename index_t, std::size_t S, typename Alloc>
+    struct fenwick_order {
+        using pos_t = uint_for<scaled<S, 2, 1>>;
+        using cursor = pos_t;
+        static constexpr bool random_access = true;
+        static constexpr bool late_insert = true;
+        static constexpr index_t nil = std::numeric_limits<index_t>::max();
+        static constexpr std::size_t block = 64; // Shift distance before spreading, and smallest window
+
+        std::size_t P; // Timeline length, 2S
+        column<index_t, scaled<S, 2, 1>, Alloc> slots;     // position -> slot, or nil; plus a nil sentinel
+        column<pos_t,   S,               Alloc> positions; // slot -> position
+        column<pos_t,   scaled<S, 2, 1>, Alloc> tree;      // 1-based Fenwick tree of occupancy
+        pos_t end {0};
+
+        constexpr fenwick_order(std::size_t capacity, const Alloc& alloc)
+            : P{2 * capacity}, slots(P + 1, alloc), positions(capacity, alloc), tree(P + 1, alloc) {
+            slots.fill(nil);
+            tree.fill(0);
+        }
+
+        constexpr void count(pos_t p, bool add) noexcept {
+            for (std::size_t i = std::size_t{p} + 1; i <= P; i += i & (~i + 1)) {
+                add ? ++tree[i] : --tree[i];
+            }
+        }
+
+        /** @brief Occupied positions before `p`. */
+        constexpr std::size_t prefix(std::size_t p) const noexcept {
+            std::size_t n = 0;
+            for (; p; p -= p & (~p + 1)) n += tree[p];
+            return n;
+        }
+
+        /** @brief Position of the occupied position with 0-based `rank`. */
+        constexpr pos_t find(index_t rank) const noexcept {
+            std::size_t p = 0, k = std::size_t{rank} + 1, step = 1;
+            while (step * 2 <= P) step *= 2;
+            for (; step; step /= 2) {
+                if (p + step <= P && tree[p + step] < k) {
+                    p += step;
+                    k -= tree[p];
+                }
+            }
+            return static_cast<pos_t>(p);
+        }
+
+        constexpr void place(index_t slot, pos_t p) noexcept {
+            slots[p] = slot;
+            positions[slot] = p;
+            count(p, true);
+        }
+
+        constexpr void remove(index_t slot) noexcept {
+            slots[positions[slot]] = nil;
+            count(positions[slot], false);
+        }
+
+        /** @brief Linear-time Fenwick construction of the nodes `(lo, hi]`,
+                   which must only cover positions from `lo` on. */
+        constexpr void build(std::size_t lo, std::size_t hi) noexcept {
+            std::fill(tree.begin() + lo + 1, tree.begin() + hi + 1, 0);
+            for (std::size_t i = lo + 1; i <= hi; ++i) {
+                tree[i] += slots[i - 1] != nil;
+                const std::size_t j = i + (i & (~i + 1));
+                if (j <= hi) tree[j] += tree[i];
+            }
+        }
+
+        /** @brief Spread the samples in `[lo, hi)` evenly over `[lo, lo + span)`,
+                   `span` being at least their number. Leaves the tree as is. */
+        constexpr void spread(std::size_t lo, std::size_t hi, std::size_t span) noexcept {
+            std::size_t n = lo;
+            for (std::size_t from = lo; from < hi; ++from) {
+                if (slots[from] == nil) continue;
+                const index_t slot = slots[from];
+                slots[from] = nil;
+                slots[n++] = slot;
+            }
+            n -= lo;
+            // Back to front, targets never overlap samples still to be moved
+            for (std::size_t i = n; i-- > 0;) {
+                const index_t slot = slots[lo + i];
+                const auto to = static_cast<pos_t>(lo + i * span / n);
+                slots[lo + i] = nil;
+                slots[to] = slot;
+                positions[slot] = to;
+            }
+            if (n) end = std::max(end, static_cast<pos_t>(lo + (n - 1) * span / n + 1));
+        }
+
+        /** @brief Spread the samples over the front of the timeline, keeping
+                   half of the free positions as holes between them and half
+                   at the back for appends. */
+        constexpr void compact() noexcept {
+            std::size_t n = 0;
+            for (pos_t from = 0; from < end; ++from) n += slots[from] != nil;
+            const pos_t old_end = end;
+            end = 0;
+            spread(0, old_end, n + (P - n) / 2);
+            build(0, P);
+        }
+
+        /**
+         * @brief Spread the smallest aligned window around `p` whose density
+         * is under its threshold. Thresholds go from full for `block`
+         * positions down to half full for the whole timeline, which at most
+         * S of the 2S positions ever are, so a window always qualifies.
+         */
+        constexpr void rebalance(std::size_t p) noexcept {
+            std::size_t levels = 1;
+            while ((block << levels) < P) ++levels;
+            for (std::size_t l = 0;; ++l) {
+                const std::size_t size = block << l;
+                const std::size_t lo = p / size * size, hi = std::min(lo + size, P);
+                const std::size_t n = prefix(hi) - prefix(lo);
+                if (n * 2 * levels < (hi - lo) * (2 * levels - l)) {
+                    spread(lo, hi, hi - lo);
+                    // Nodes covering more than the window keep their counts
+                    return build(lo, hi == lo + size ? hi - 1 : hi);
+                }
+            }
+        }
+
+        constexpr index_t at(index_t rank, index_t) const noexcept { return slots[find(rank)]; }
+
+        constexpr void append(index_t slot, index_t) noexcept {
+            if (end == P) compact();
+            place(slot, end++);
+        }
+
+        constexpr void move_to_back(index_t slot, index_t n) noexcept {
+            remove(slot);
+            append(slot, n - 1);
+        }
+
+        constexpr void insert(index_t slot, index_t rank, index_t n) noexcept {
+            if (rank == n) return append(slot, n);
+            // Reuse a hole right before the sample currently at `rank`
+            pos_t p = find(rank);
+            if (p > 0 && slots[p - 1] == nil) return place(slot, p - 1);
+            // Otherwise shift the samples up to the nearest hole by one
+            for (std::size_t d = 1, limit = block;; ++d) {
+                if (d > limit) {
+                    rebalance(p);
+                    p = find(rank);
+                    d = 0;
+                    limit = P;
+                    continue;
+                }
+                if (p + d < P && slots[p + d] == nil) {
+                    const std::size_t q = p + d;
+                    std::move_backward(slots.begin() + p, slots.begin() + q, slots.begin() + q + 1);
+                    for (std::size_t i = p + 1; i <= q; ++i) positions[slots[i]] = static_cast<pos_t>(i);
+                    slots[p] = slot;
+                    positions[slot] = p;
+                    if (q >= end) end = static_cast<pos_t>(q + 1);
+                    // Only position q changed from free to taken
+                    return count(static_cast<pos_t>(q), true);
+                }
+                if (d <= p && slots[p - d] == nil) {
+                    const std::size_t q = p - d;
+                    std::move(slots.begin() + q + 1, slots.begin() + p, slots.begin() + q);
+                    for (std::size_t i = q; i + 1 < p; ++i) positions[slots[i]] = static_cast<pos_t>(i);
+                    slots[p - 1] = slot;
+                    positions[slot] = static_cast<pos_t>(p - 1);
+                    return count(static_cast<pos_t>(q), true);
+                }
+            }
+        }
+
+        constexpr void relocate(index_t slot, index_t rank, index_t n) noexcept {
+            remove(slot);
+            insert(slot, rank, n - 1);
+        }
+
+        constexpr void assign(const index_t* seq, index_t n) noexcept {
+            std::fill(slots.begin(), slots.begin() + end, nil);
+            std::copy(seq, seq + n, slots.begin());
+            for (index_t i = 0; i < n; ++i) positions[seq[i]] = i;
+            end = n;
+            compact();
+        }
+
+        constexpr cursor seek(index_t rank, index_t n) const noexcept { return rank < n ? find(rank) : end; }
+        constexpr cursor next(cursor c) const noexcept {
+            do ++c; while (c < end && slots[c] == nil);
+            return c;
+        }
+        constexpr cursor prev(cursor c) const noexcept {
+            do --c; while (c < end && slots[c] == nil);
+            return c;
+        }
+        constexpr index_t slot(cursor c) const noexcept { return slots[c]; }
+    };
+
+    /** @brief No timestamp lookup, `has()` scans. */
+    template <typename index_t, std::size_t S, typename T_time, typename Alloc>
+    struct no_lookup {
+        static constexpr bool enabled = false;
+        constexpr no_lookup(std::size_t, const Alloc&) noexcept {}
+        constexpr void insert(index_t, const T_time*) noexcept {}
+        constexpr void erase(index_t, const T_time*) noexcept {}
+        constexpr void rebuild(const T_time*, index_t) noexcept {}
+    };
+
+    /**
+     * @brief Open addressing timestamp -> slot multimap with linear probing,
+     * at most half full. Erasing shifts later entries of the probe run back,
+     * so no tombstones are needed.
+     */
+    template <typename index_t, std::size_t S, typename T_time, typename Alloc>
+    struct hash_lookup {
+        static constexpr bool enabled = true;
+        static constexpr index_t nil = std::numeric_limits<index_t>::max();
+        static constexpr std::size_t H = S == dynamic ? dynamic : ceil_pow2(2 * S);
+
+        std::size_t bits;
+        std::size_t mask;
+        column<index_t, H, Alloc> table;
+
+        constexpr hash_lookup(std::size_t capacity, const Alloc& alloc)
+            : bits{0}, mask{ceil_pow2(std::max<std::size_t>(2 * capacity, 2)) - 1}, table(mask + 1, alloc) {
+            while ((std::size_t{1} << bits) <= mask) ++bits;
+            table.fill(nil);
+        }
+
+        constexpr std::size_t bucket(const T_time& t) const noexcept {
+            // Fibonacci hashing, spreads sequential timestamps
+            return static_cast<std::size_t>((static_cast<uint64_t>(std::hash<T_time>{}(t)) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+        }
+
+        constexpr void insert(index_t slot, const T_time* timestamps) noexcept {
+            std::size_t i = bucket(timestamps[slot]);
+            while (table[i] != nil) i = (i + 1) & mask;
+            table[i] = slot;
+        }
+
+        constexpr void erase(index_t slot, const T_time* timestamps) noexcept {
+            std::size_t i = bucket(timestamps[slot]);
+            while (table[i] != slot) i = (i + 1) & mask;
+            for (std::size_t j = (i + 1) & mask; table[j] != nil; j = (j + 1) & mask) {
+                const std::size_t home = bucket(timestamps[table[j]]);
+                // Move back unless its home lies cyclically in (i, j]
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                    table[i] = table[j];
+                    i = j;
+                }
+            }
+            table[i] = nil;
+        }
+
+        constexpr void rebuild(const T_time* timestamps, index_t n) noexcept {
+            table.fill(nil);
+            for (index_t i = 0; i < n; ++i) insert(i, timestamps);
+        }
+
+        /** @brief First slot with timestamp `t` that satisfies `pred`, or `nil`. */
+        template <typename Pred>
+        constexpr index_t find(const T_time& t, const T_time* timestamps, Pred&& pred) const noexcept {
+            for (std::size_t i = bucket(t); table[i] != nil; i = (i + 1) & mask) {
+                if (timestamps[table[i]] == t && pred(table[i])) return table[i];
+            }
+            return nil;
+        }
+    };
+
+    /** @brief No snapshots, nothing tracked. */
+    template <typename index_t, typename T_value, typename T_time, typename T_score, bool Reverse>
+    struct no_snapshots {
+        static constexpr bool enabled = false;
+        constexpr explicit no_snapshots(std::size_t) noexcept {}
+        constexpr void mark(index_t) noexcept {}
+        constexpr void mark_all() noexcept {}
+        constexpr void erase(index_t) noexcept {}
+        constexpr void insert(index_t, std::size_t) noexcept {}
+        constexpr void reorder() noexcept {}
+    };
+
+    /** @brief `C` consecutive slots of all three columns, immutable once shared. */
+    template <typename T_value, typename T_time, typename T_score, std::size_t C>
+    struct snapshot_chunk {
+        std::array<T_value, C> values;
+        std::array<T_time,  C> timestamps;
+        std::array<T_score, C> scores;
+    };
+
+    /**
+     * @brief Immutable copy of a series, sharing unchanged chunks and pieces
+     * of the order with other snapshots of the same series. Safe to read
+     * from any thread.
+     */
+    template <typename index_t, typename T_value, typename T_time, typename T_score, bool Reverse, std::size_t C>
+    class cow_snapshot {
+        using chunk = snapshot_chunk<T_value, T_time, T_score, C>;
+        template <typename, typename, typename, typename, bool, std::size_t>
+        friend struct cow_snapshots;
+
+        std::vector<std::shared_ptr<const chunk>> chunks;
+        std::vector<std::shared_ptr<const std::vector<index_t>>> pieces; // Slots, oldest first
+        std::vector<std::size_t> ends; // Rank past the last slot of each piece
+
+        class iterator {
+        public:
+            constexpr iterator(const cow_snapshot& snap, std::size_t _i) noexcept : s{snap}, i{_i} {}
+            constexpr iterator& operator++()       noexcept { ++i; return *this; }
+            constexpr bool      operator!=(const iterator& other) const noexcept { return i != other.i; }
+            constexpr auto      operator* () const noexcept { return s[i]; }
+        private:
+            const cow_snapshot& s;
+            std::size_t i;
+        };
+    public:
+        /** @brief Amount of samples in the snapshot. */
+        std::size_t size() const noexcept { return ends.empty() ? 0 : ends.back(); }
+
+        /** @brief `n`th sample in the series' iteration order, O(log(S/C)). */
+        std::tuple<const T_value&, const T_time&, const T_score&> operator[](std::size_t n) const noexcept {
+            const std::size_t r = Reverse ? size() - 1 - n : n;
+            const auto p = static_cast<std::size_t>(std::upper_bound(ends.begin(), ends.end(), r) - ends.begin());
+            const std::size_t o = (*pieces[p])[r - (p ? ends[p - 1] : 0)];
+            const chunk& c = *chunks[o / C];
+            return { c.values[o % C], c.timestamps[o % C], c.scores[o % C] };
+        }
+
+        iterator begin() const noexcept { return { *this, 0 }; }
+        iterator end() const noexcept { return { *this, size() }; }
+    };
+
+    /**
+     * @brief Snapshot support: remembers the chunks handed out with the
+     * previous snapshot and which were written since. The order as of that
+     * snapshot is kept in pieces of at most `C` slots, shared the same way;
+     * changes since are logged and replayed on the next snapshot, copying
+     * only the pieces they touch, at O(C + S/C) each. Once that would cost
+     * more than walking the order, or after `reorder()`, the next snapshot
+     * walks it instead.
+     */
+    template <typename index_t, typename T_value, typename T_time, typename T_score, bool Reverse, std::size_t C>
+    struct cow_snapshots {
+        static constexpr bool enabled = true;
+        using chunk = snapshot_chunk<T_value, T_time, T_score, C>;
+        using snapshot_type = cow_snapshot<index_t, T_value, T_time, T_score, Reverse, C>;
+        using piece = std::vector<index_t>;
+        static constexpr std::size_t gone = std::numeric_limits<std::size_t>::max();
+
+        /** @brief `slot` was inserted at `rank`, or erased if `gone`. */
+        struct change {
+            index_t slot;
+            std::size_t rank;
+        };
+
+        std::vector<std::shared_ptr<const chunk>> shared;
+        std::vector<char> dirty;
+
+        std::vector<std::shared_ptr<piece>> pieces; // By id
+        std::vector<char> owned;                    // By id, not handed out yet, so writable
+        std::vector<uint32_t> seq;                  // Piece ids, oldest first
+        std::vector<uint32_t> spare;                // Unused ids
+        std::vector<uint32_t> where;                // Slot -> piece id
+        std::vector<change> log;                    // Reserved, so logging cannot throw
+        std::size_t budget;
+        bool rebuild {true};
+
+        explicit cow_snapshots(std::size_t capacity)
+            : shared((capacity + C - 1) / C), dirty(shared.size(), 1), where(capacity),
+              budget{std::max<std::size_t>(2, capacity / (C + capacity / C))} {
+            log.reserve(budget);
+        }
+        cow_snapshots(const cow_snapshots& other)
+            : shared{other.shared}, dirty{other.dirty}, pieces{other.pieces}, owned{other.owned}, seq{other.seq},
+              spare{other.spare}, where{other.where}, log{other.log}, budget{other.budget}, rebuild{other.rebuild} {
+            // Pieces are only written inside `take()`, which clears `owned`
+            // before it returns or leaves a `rebuild`, so sharing them is safe
+            log.reserve(budget);
+        }
+        cow_snapshots(cow_snapshots&&) noexcept = default;
+        cow_snapshots& operator=(const cow_snapshots& other) {
+            if (this != &other) *this = cow_snapshots(other);
+            return *this;
+        }
+        cow_snapshots& operator=(cow_snapshots&&) noexcept = default;
+
+        /** @brief The chunk of `slot` was written. */
+        void mark(index_t slot) noexcept { dirty[slot / C] = 1; }
+        void mark_all() noexcept { std::fill(dirty.begin(), dirty.end(), 1); }
+
+        /** @brief `slot` left the order. */
+        void erase(index_t slot) noexcept { record({ slot, gone }); }
+        /** @brief `slot` entered the order at chronological `rank`. */
+        void insert(index_t slot, std::size_t rank) noexcept { record({ slot, rank }); }
+        /** @brief The order changed as a whole. */
+        void reorder() noexcept {
+            rebuild = true;
+            log.clear();
+        }
+
+        void record(const change c) noexcept {
+            if (rebuild) return;
+            if (log.size() == budget) return reorder();
+            log.push_back(c);
+        }
+
+        /** @brief Piece `id`, copied first if a snapshot shares it. */
+        piece& writable(uint32_t id) {
+            if (!owned[id]) {
+                pieces[id] = std::make_shared<piece>(*pieces[id]);
+                owned[id] = 1;
+            }
+            return *pieces[id];
+        }
+
+        uint32_t make_piece() {
+            if (spare.empty()) {
+                pieces.emplace_back();
+                owned.push_back(0);
+                spare.push_back(static_cast<uint32_t>(pieces.size() - 1));
+            }
+            const uint32_t id = spare.back();
+            pieces[id] = std::make_shared<piece>();
+            owned[id] = 1;
+            spare.pop_back();
+            return id;
+        }
+
+        /** @brief Remove the piece at position `i` of the order. */
+        void drop(std::size_t i) {
+            const uint32_t id = seq[i];
+            pieces[id].reset();
+            owned[id] = 0;
+            spare.push_back(id);
+            seq.erase(seq.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+
+        /** @brief Move the slots of the piece after position `i` into it. */
+        void merge(std::size_t i) {
+            piece& a = writable(seq[i]);
+            const piece& b = *pieces[seq[i + 1]];
+            for (const auto slot : b) where[slot] = seq[i];
+            a.insert(a.end(), b.begin(), b.end());
+            drop(i + 1);
+        }
+
+        /** @brief Move the back half of the piece at position `i` into a new
+                   piece after it. */
+        void split(std::size_t i) {
+            const uint32_t id = make_piece();
+            piece& a = *pieces[seq[i]];
+            piece& b = *pieces[id];
+            b.assign(a.begin() + static_cast<std::ptrdiff_t>(a.size() / 2), a.end());
+            a.resize(a.size() / 2);
+            for (const auto slot : b) where[slot] = id;
+            seq.insert(seq.begin() + static_cast<std::ptrdiff_t>(i + 1), id);
+        }
+
+        void replay_erase(index_t slot) {
+            const uint32_t id = where[slot];
+            piece& p = writable(id);
+            p.erase(std::find(p.begin(), p.end(), slot));
+            const auto i = static_cast<std::size_t>(std::find(seq.begin(), seq.end(), id) - seq.begin());
+            if (p.empty()) return drop(i);
+            // Any two neighbours hold over C/2 slots, so there are at most
+            // about 4S/C pieces
+            if (i > 0 && pieces[seq[i - 1]]->size() + p.size() <= C / 2) return merge(i - 1);
+            if (i + 1 < seq.size() && p.size() + pieces[seq[i + 1]]->size() <= C / 2) merge(i);
+        }
+
+        void replay_insert(index_t slot, std::size_t rank) {
+            if (seq.empty()) seq.push_back(make_piece());
+            // Piece holding `rank` or ending right before it
+            std::size_t i = 0, first = 0;
+            for (; i + 1 < seq.size() && first + pieces[seq[i]]->size() < rank; ++i) first += pieces[seq[i]]->size();
+            if (i + 1 == seq.size() && rank - first == C) {
+                // Appending to a full last piece starts a new one
+                seq.push_back(make_piece());
+                ++i;
+                first = rank;
+            }
+            piece& p = writable(seq[i]);
+            p.insert(p.begin() + static_cast<std::ptrdiff_t>(rank - first), slot);
+            where[slot] = seq[i];
+            if (p.size() > C) split(i);
+        }
+
+        /** @brief Replace the pieces by `order`, cut every `C` slots. */
+        void assign(const std::vector<index_t>& order) {
+            pieces.clear();
+            owned.clear();
+            seq.clear();
+            spare.clear();
+            for (std::size_t from = 0; from < order.size(); from += C) {
+                const uint32_t id = make_piece();
+                pieces[id]->assign(order.begin() + static_cast<std::ptrdiff_t>(from), order.begin() + static_cast<std::ptrdiff_t>(std::min(order.size(), from + C)));
+                for (const auto slot : *pieces[id]) where[slot] = id;
+                seq.push_back(id);
+            }
+        }
+
+        /** @brief Snapshot of the columns, of which slots `0..occupied-1` are
+                   in use; `walk()` returns those slots, oldest first, and is
+                   only called if the log of order changes was given up. */
+        template <typename Walk>
+        snapshot_type take(const T_value* values, const T_time* timestamps, const T_score* scores, std::size_t occupied,
+                           Walk&& walk) {
+            for (std::size_t i = 0; i < shared.size() && i * C < occupied; ++i) {
+                if (!dirty[i]) continue;
+                auto c = std::make_shared<chunk>();
+                const std::size_t from = i * C, n = std::min(C, occupied - from);
+                std::copy(values + from, values + from + n, c->values.begin());
+                std::copy(timestamps + from, timestamps + from + n, c->timestamps.begin());
+                std::copy(scores + from, scores + from + n, c->scores.begin());
+                shared[i] = std::move(c);
+                dirty[i] = 0;
+            }
+            // Walk next time if this throws halfway
+            const bool full = rebuild;
+            rebuild = true;
+            if (full) {
+                assign(walk());
+            } else {
+                for (const auto& c : log) c.rank == gone ? replay_erase(c.slot) : replay_insert(c.slot, c.rank);
+            }
+            log.clear();
+            rebuild = false;
+
+            snapshot_type res;
+            res.chunks = shared;
+            res.pieces.reserve(seq.size());
+            res.ends.reserve(seq.size());
+            std::size_t n = 0;
+            for (const auto id : seq) {
+                res.pieces.push_back(pieces[id]);
+                res.ends.push_back(n += pieces[id]->size());
+                owned[id] = 0;
+            }
+            return res;
+        }
+    };
+
+    /** @brief No best-K tracking, `best` selects from all scores. */
+    template <typename index_t, typename T_time, typename T_score>
+    struct no_top_k {
+        static constexpr std::size_t K = 0;
+        constexpr void update(index_t, const T_score*, const T_time*) noexcept {}
+        constexpr void invalidate() noexcept {}
+    };
+
+    /**
+     * @brief The best slots, oldest first, each with the score it had when it
+     * came in: up to `2K`, so members can get worse without reselecting.
+     * The held slots are always exactly the best `size`. A new or improved
+     * sample takes its place in O(K). A member getting worse stays if it
+     * still beats the best slot not held, which is known after a new sample
+     * pushed one out, and is dropped otherwise. `best` selects again only
+     * once fewer slots are held than it needs.
+     */
+    template <typename index_t, typename T_time, typename T_score, std::size_t N>
+    struct top_k {
+        static_assert(N > 0, "sts::top_k needs K > 0");
+        static constexpr std::size_t K = N;
+        static constexpr std::size_t cap = 2 * K;
+
+        mutable std::array<index_t, cap> slots {};
+        mutable std::array<T_score, cap> kept {};
+        mutable std::size_t size {0};
+        mutable bool valid {true};
+        mutable bool all {true};        // Every occupied slot is held
+        mutable bool has_runner {false}; // Best slot not held is known
+        mutable index_t runner {0};
+        mutable T_score runner_kept {};
+
+        /** @brief Chronological order, ties by slot as in `best`. */
+        static constexpr bool before(const T_time* timestamps, index_t a, index_t b) noexcept {
+            return timestamps[a] < timestamps[b] || (timestamps[a] == timestamps[b] && a < b);
+        }
+
+        constexpr void erase(std::size_t i) noexcept {
+            std::copy(slots.begin() + i + 1, slots.begin() + size, slots.begin() + i);
+            std::copy(kept.begin() + i + 1, kept.begin() + size, kept.begin() + i);
+            --size;
+        }
+
+        constexpr void place(index_t slot, const T_score* scores, const T_time* timestamps) noexcept {
+            std::size_t i = size++;
+            for (; i > 0 && before(timestamps, slot, slots[i - 1]); --i) {
+                slots[i] = slots[i - 1];
+                kept[i] = kept[i - 1];
+            }
+            slots[i] = slot;
+            kept[i] = scores[slot];
+        }
+
+        constexpr std::size_t worst(const T_score* scores) const noexcept {
+            std::size_t w = 0;
+            for (std::size_t i = 1; i < size; ++i) {
+                if (detail::worse(scores, slots[i], slots[w])) w = i;
+            }
+            return w;
+        }
+
+        constexpr void set_runner(index_t slot, const T_score* scores) noexcept {
+            runner = slot;
+            runner_kept = scores[slot];
+            has_runner = true;
+        }
+
+        /** @brief `slot` was written or rescored. */
+        constexpr void update(index_t slot, const T_score* scores, const T_time* timestamps) noexcept {
+            if (!valid) return;
+            std::size_t m = 0;
+            while (m < size && slots[m] != slot) ++m;
+            if (m < size) {
+                const bool worse_now = scores[slot] > kept[m];
+                erase(m);
+                if (worse_now && !all) {
+                    if (has_runner && detail::worse(scores, slot, runner)) {
+                        // The runner takes its place, the next best is unknown
+                        has_runner = false;
+                        return place(runner, scores, timestamps);
+                    }
+                    // Without a runner, keep it only if it beats a held slot
+                    if (!has_runner && (size == 0 || detail::worse(scores, slot, slots[worst(scores)]))) return;
+                }
+                return place(slot, scores, timestamps);
+            }
+            if (all && size < cap) return place(slot, scores, timestamps);
+            const bool first_out = all;
+            all = false;
+            if (has_runner && runner == slot) {
+                // Still the best one not held only if it did not get worse
+                has_runner = !(scores[slot] > runner_kept);
+                runner_kept = scores[slot];
+            }
+            if (size > 0) {
+                const std::size_t w = worst(scores);
+                if (detail::worse(scores, slots[w], slot)) {
+                    if (runner == slot) has_runner = false;
+                    if (size == cap) {
+                        set_runner(slots[w], scores);
+                        erase(w);
+                    }
+                    return place(slot, scores, timestamps);
+                }
+            }
+            if (first_out || (has_runner && detail::worse(scores, runner, slot))) set_runner(slot, scores);
+        }
+
+        constexpr void invalidate() noexcept { valid = false; }
+
+        /** @brief Take the `n` slots now in `slots` as the best ones, `whole`
+                   if they are all occupied slots. */
+        constexpr void assign(std::size_t n, const T_score* scores, const T_time* timestamps, bool whole) const noexcept {
+            std::sort(slots.begin(), slots.begin() + n, [timestamps](index_t a, index_t b) { return before(timestamps, a, b); });
+            for (std::size_t i = 0; i < n; ++i) kept[i] = scores[slots[i]];
+            size = n;
+            valid = true;
+            all = whole;
+            has_runner = false;
+        }
+
+        /** @brief Write the `k <= size` best slots to `out`, oldest first. */
+        constexpr void select(index_t* out, std::size_t k, const T_score* scores) const noexcept {
+            if (k == size) {
+                std::copy(slots.begin(), slots.begin() + k, out);
+                return;
+            }
+            std::array<std::size_t, cap> pos {};
+            std::iota(pos.begin(), pos.begin() + size, std::size_t{0});
+            std::nth_element(pos.begin(), pos.begin() + k, pos.begin() + size, [&](std::size_t a, std::size_t b) {
+                return worse(scores, slots[b], slots[a]);
+            });
+            std::array<bool, cap> picked {};
+            for (std::size_t i = 0; i < k; ++i) picked[pos[i]] = true;
+            for (std::size_t i = 0; i < size; ++i) {
+                if (picked[i]) *out++ = slots[i];
+            }
+        }
+    };
+
+    /**
+     * @brief The `(value&, timestamp&, score&)` tuple iterators dereference
+     * to. A `std::tuple` of references in all but name, so that it can have
+     * a common reference with the tuple of values (see below), which
+     * `std::tuple` only has from C++23 on.
+     */
+    template <typename... Refs>
+    struct sample_ref : std::tuple<Refs...> {
+        using std::tuple<Refs...>::tuple;
+        /** @brief Refer to the elements of a tuple of values. */
+        template <typename... Ts, typename = std::enable_if_t<(std::is_constructible_v<Refs, Ts&> && ...)>>
+        constexpr sample_ref(std::tuple<Ts...>& t) noexcept
+            : std::tuple<Refs...>(std::apply([](auto&... x) { return std::tuple<Refs...>(x...); }, t)) {}
+    };
+} // namespace detail
+
+/** @brief Score index policy: find the worst sample with a linear scan (default). */
+struct worst_scan {
+    using category = detail::score_index_category;
+    template <typename index_t, std::size_t S, typename T_score, typename Alloc>
+    using impl = detail::scan_index<index_t, S, T_score, Alloc, false>;
+};
+
+/** @brief Score index policy: linear scan that remembers the worst sample,
+           so rejecting a sample is a single compare. Like `sts::worst_heap`
+           it needs `rescore(...)`, or `reindex()` after writing scores in
+           place. */
+struct worst_cached {
+    using category = detail::score_index_category;
+    template <typename index_t, std::size_t S, typename T_score, typename Alloc>
+    using impl = detail::scan_index<index_t, S, T_score, Alloc, true>;
+};
+
+/** @brief Score index policy: indexed max-heap, O(log S) eviction at the cost
+           of two extra `index_t` arrays. */
+struct worst_heap {
+    using category = detail::score_index_category;
+    template <typename index_t, std::size_t S, typename T_score, typename Alloc>
+    using impl = detail::heap_index<index_t, S, T_score, Alloc>;
+};
+
+/** @brief Score index policy: indexed min-max heap, O(1) best and worst and
+           O(log S) eviction, at the cost of two extra `index_t` arrays. */
+struct minmax_heap {
+    using category = detail::score_index_category;
+    template <typename index_t, std::size_t S, typename T_score, typename Alloc>
+    using impl = detail::minmax_heap_index<index_t, S, T_score, Alloc>;
+};
+
+/** @brief Allocator policy: allocator for the columns of a `sts::dynamic`
+           series, defaults to `std::allocator`. */
+template <typename Alloc>
+struct allocator {
+    using category = detail::allocator_category;
+    using type = Alloc;
+};
+
+/** @brief Lookup policy: none, `has()` scans the stored samples (default). */
+struct no_lookup {
+    using category = detail::lookup_category;
+    template <typename index_t, std::size_t S, typename T_time, typename Alloc>
+    using impl = detail::no_lookup<index_t, S, T_time, Alloc>;
+};
+
+/** @brief Lookup policy: timestamp hash index, O(1) `has()` at the cost of
+           an `index_t` table of 2S to 4S entries. */
+struct timestamp_hash {
+    using category = detail::lookup_category;
+    template <typename index_t, std::size_t S, typename T_time, typename Alloc>
+    using impl = detail::hash_lookup<index_t, S, T_time, Alloc>;
+};
+
+/** @brief Order policy: dense array of slots, O(1) `[]`, O(S) eviction
+           (default for `S > 64`). */
+struct dense_order {
+    using category = detail::order_category;
+    template <typename index_t, std::size_t S, typename Alloc>
+    using impl = detail::dense_order<index_t, S, Alloc>;
+};
+
+/** @brief Order policy: byte permutation vector for `S <= 64`, found and
+           shifted with a few vector ops (default for such `S`). */
+struct small_order {
+    using category = detail::order_category;
+    template <typename index_t, std::size_t S, typename Alloc>
+    using impl = detail::small_order<index_t, S, Alloc>;
+};
+
+/** @brief Order policy: doubly linked slots, O(1) eviction and append, `[]`
+           walks from the nearest end. */
+struct linked_order {
+    using category = detail::order_category;
+    template <typename index_t, std::size_t S, typename Alloc>
+    using impl = detail::linked_order<index_t, S, Alloc>;
+};
+
+/** @brief Order policy: Fenwick tree over a timeline of slots, O(log S) `[]`
+           and eviction, amortized O(1) append and O(log^2 S) late insert. */
+struct fenwick_order {
+    using category = detail::order_category;
+    template <typename index_t, std::size_t S, typename Alloc>
+    using impl = detail::fenwick_order<index_t, S, Alloc>;
+};
+
+/** @brief Snapshot policy: no `snapshot()` (default). */
+struct no_snapshots {
+    using category = detail::snapshot_category;
+    template <typename index_t, typename T_value, typename T_time, typename T_score, bool Reverse>
+    using impl = detail::no_snapshots<index_t, T_value, T_time, T_score, Reverse>;
+};
+
+/** @brief Snapshot policy: `snapshot()` shares chunks of `C` samples, and
+           pieces of up to `C` of the chronological order, with the previous
+           snapshot and only copies those changed since. */
+template <std::size_t C = 1024>
+struct cow_snapshots {
+    using category = detail::snapshot_category;
+    template <typename index_t, typename T_value, typename T_time, typename T_score, bool Reverse>
+    using impl = detail::cow_snapshots<index_t, T_value, T_time, T_score, Reverse, C>;
+};
+
+/** @brief Eviction policy: evicted samples are overwritten silently (default). */
+struct no_eviction_sink {
+    using category = detail::eviction_category;
+    using type = detail::discard;
+};
+
+/** @brief Eviction policy: a `Sink` instance is called as
+           `sink(value&, timestamp, score)` with every sample about to be
+           evicted; it may move the value out. It must not throw. A new
+           value that may throw is built before the sink is called, so a
+           failed add leaves the evicted sample in place. */
+template <typename Sink>
+struct eviction_sink {
+    using category = detail::eviction_category;
+    using type = Sink;
+};
+
+/** @brief Value storage policy: values in a column like the other fields,
+           inline for a fixed `S` (default). */
+struct inline_values {
+    using category = detail::value_storage_category;
+    template <typename T, std::size_t S, typename Alloc>
+    using impl = detail::column<T, S, Alloc>;
+};
+
+/** @brief Value storage policy: values in a separately allocated slab, each
+           slot constructed on its first write. Keeps a fixed size series
+           compact and cheap to move when values are large. */
+struct slab_values {
+    using category = detail::value_storage_category;
+    template <typename T, std::size_t, typename Alloc>
+    using impl = detail::value_slab<T, Alloc>;
+};
+
+/** @brief Best-K policy: none, `best` selects from all scores (default). */
+struct no_top_k {
+    using category = detail::top_k_category;
+    template <typename index_t, typename T_time, typename T_score>
+    using impl = detail::no_top_k<index_t, T_time, T_score>;
+};
+
+/** @brief Best-K policy: keep the `K` best samples up to date while adding,
+           inserting and rescoring, so `best` for up to `K` samples is O(K).
+           Holds up to `2K`, so samples rescored worse rarely force a full
+           selection. */
+template <std::size_t K>
+struct top_k {
+    using category = detail::top_k_category;
+    template <typename index_t, typename T_time, typename T_score>
+    using impl = detail::top_k<index_t, T_time, T_score, K>;
+};
+} // namespace sts
+
+template <typename... Refs>
+struct std::tuple_size<sts::detail::sample_ref<Refs...>> : std::integral_constant<std::size_t, sizeof...(Refs)> {};
+template <std::size_t I, typename... Refs>
+struct std::tuple_element<I, sts::detail::sample_ref<Refs...>> : std::tuple_element<I, std::tuple<Refs...>> {};
+
+#if __cplusplus >= 202002L && defined(__cpp_lib_concepts)
+// Element-wise, so iterators model std::indirectly_readable with a tuple of
+// values as `value_type`
+template <typename... Refs, typename... Ts, template <typename> class RQual, template <typename> class TQual>
+    requires (sizeof...(Refs) == sizeof...(Ts))
+struct std::basic_common_reference<sts::detail::sample_ref<Refs...>, std::tuple<Ts...>, RQual, TQual> {
+    using type = sts::detail::sample_ref<std::common_reference_t<RQual<Refs>, TQual<Ts>>...>;
+};
+template <typename... Ts, typename... Refs, template <typename> class TQual, template <typename> class RQual>
+    requires (sizeof...(Refs) == sizeof...(Ts))
+struct std::basic_common_reference<std::tuple<Ts...>, sts::detail::sample_ref<Refs...>, TQual, RQual> {
+    using type = sts::detail::sample_ref<std::common_reference_t<TQual<Ts>, RQual<Refs>>...>;
+};
+#endif
 
 /**
  * @brief Store selected samples of a time_series, based on a score (0 being
  * best, higher = worse) and allow efficient in-order access.
  * 
  * @tparam T_value Value type
- * @tparam S       Samples to store
+ * @tparam S       Samples to store, or `sts::dynamic` to set at construction
  * @tparam Reverse Iteration order: false == "oldest first", true == "newest first"
  * @tparam T_time  Timestamp type 
  * @tparam T_score Score type
+ * @tparam Policies Optional policy tags, in any order (see namespace `sts`):
+ *                  - score index: `sts::worst_scan` (default), `sts::worst_cached`,
+ *                                 `sts::worst_heap`, `sts::minmax_heap`
+ *                  - order:       `sts::dense_order` (default), `sts::small_order`
+ *                                 (default for `S <= 64`), `sts::linked_order`,
+ *                                 `sts::fenwick_order`
+ *                  - lookup:      `sts::no_lookup` (default), `sts::timestamp_hash`
+ *                  - snapshots:   `sts::no_snapshots` (default), `sts::cow_snapshots<C>`
+ *                  - eviction:    `sts::no_eviction_sink` (default), `sts::eviction_sink<F>`
+ *                  - values:      `sts::inline_values` (default), `sts::slab_values`
+ *                  - best-K:      `sts::no_top_k` (default), `sts::top_k<K>`
+ *                  - allocator:   `sts::allocator<A>`, for `sts::dynamic` columns
  */
-template <typename T_value, std::size_t S, bool Reverse = false, typename T_time = std::size_t, typename T_score = float>
-class selective_time_series {
+template <typename T_value, std::size_t S, bool Reverse = false, typename T_time = std::size_t, typename T_score = float, typename... Policies>
+class selective_time_series : private sts::detail::extent<S> {
 private:
+    template <typename, std::size_t, bool, typename, typename, typename...>
+    friend class selective_time_series;
+    template <typename>
+    friend class seqlock_series;
+
     enum {
         VAL = 0,
         TIM = 1,
         SCO = 2
     };
-    // using size_t = std::size_t;
-    using index_t = std::conditional_t<(S < 256),
-                                       uint8_t,
-                                       std::conditional_t<(S < 65536),
-                                                          uint16_t,
-                                                          std::conditional_t<(S < 4294967296),
-                                                                             uint32_t, uint64_t>>>;
-
-    std::array<T_value, S> values;
-    std::array<T_time,  S> timestamps;
-    std::array<T_score, S> scores;
-    std::array<index_t, S> offsets;
+    // using size_t = std::size_t;
+    using index_t = std::conditional_t<S == sts::dynamic, uint32_t, sts::detail::uint_for<S>>;
+
+    using allocator_policy = typename sts::detail::select_policy<sts::detail::allocator_category, sts::allocator<std::allocator<T_value>>, Policies...>::type;
+    using alloc_t = typename allocator_policy::type;
+
+    template <typename T>
+    using column = sts::detail::column<T, S, alloc_t>;
+
+    using value_storage_policy = typename sts::detail::select_policy<sts::detail::value_storage_category, sts::inline_values, Policies...>::type;
+    using values_t = typename value_storage_policy::template impl<T_value, S, alloc_t>;
+
+    values_t        values;
+    column<T_time>  timestamps;
+    column<T_score> scores;
+
+    using index_policy = typename sts::detail::select_policy<sts::detail::score_index_category, sts::worst_scan, Policies...>::type;
+    typename index_policy::template impl<index_t, S, T_score, alloc_t> index;
+
+    using default_order = std::conditional_t<(S <= 64), sts::small_order, sts::dense_order>;
+    using order_policy = typename sts::detail::select_policy<sts::detail::order_category, default_order, Policies...>::type;
+    using order_t = typename order_policy::template impl<index_t, S, alloc_t>;
+    order_t order;
+
+    using lookup_policy = typename sts::detail::select_policy<sts::detail::lookup_category, sts::no_lookup, Policies...>::type;
+    typename lookup_policy::template impl<index_t, S, T_time, alloc_t> lookup;
+
+    using snapshot_policy = typename sts::detail::select_policy<sts::detail::snapshot_category, sts::no_snapshots, Policies...>::type;
+    using snapshots_t = typename snapshot_policy::template impl<index_t, T_value, T_time, T_score, Reverse>;
+    snapshots_t snapshots;
+
+    using eviction_policy = typename sts::detail::select_policy<sts::detail::eviction_category, sts::no_eviction_sink, Policies...>::type;
+    typename eviction_policy::type sink;
+
+    using top_k_policy = typename sts::detail::select_policy<sts::detail::top_k_category, sts::no_top_k, Policies...>::type;
+    using top_k_t = typename top_k_policy::template impl<index_t, T_time, T_score>;
+    top_k_t top;
+
+    index_t utilized {0};
+    T_time last_timestamp_plus_one {0};
+
+    // A fixed size moved-from series rebuilds its snapshot chunk table
+    static constexpr bool nothrow_move = std::is_nothrow_move_constructible_v<values_t>
+                                         && std::is_nothrow_move_constructible_v<typename eviction_policy::type>
+                                         && (S == sts::dynamic || !snapshots_t::enabled);
+
+    /**
+     * @brief Empty a moved-from series. Fixed size columns are still there
+     * and get reset; dynamic ones were taken, so the capacity drops to 0
+     * and no column is touched again.
+     */
+    void vacate() noexcept(nothrow_move) {
+        utilized = 0;
+        last_timestamp_plus_one = 0;
+        dirty = 0;
+        top = top_k_t{};
+        if constexpr (S == sts::dynamic) {
+            this->release();
+        } else {
+            index.rebuild(scores.data(), 0);
+            order.assign(nullptr, 0);
+            lookup.rebuild(timestamps.data(), 0);
+            if constexpr (snapshots_t::enabled) snapshots = snapshots_t(S);
+        }
+    }
+
+    /** @brief `capacity`, if the columns and indices can be sized for it. */
+    static constexpr std::size_t checked(const std::size_t capacity) {
+        if (S != sts::dynamic && capacity != S) {
+            throw std::invalid_argument("selective_time_series: capacity must equal S");
+        }
+        // The largest index is kept free as `nil` by several policies, a
+        // fixed `S` picks its index type with that room to spare
+        if (S == sts::dynamic && capacity >= std::numeric_limits<index_t>::max()) {
+            throw std::length_error("selective_time_series: capacity exceeds the slot index");
+        }
+        return capacity;
+    }
+
+    constexpr std::tuple<index_t, T_score> worst_index() const noexcept {
+        const auto wi = index.worst(scores.data(), utilized);
+        return { wi, scores[wi] };
+    }
+
+    /** @brief Chronological rank of the `n`th sample in iteration order. */
+    constexpr index_t chrono(const index_t n) const noexcept {
+        return Reverse ? static_cast<index_t>(utilized - 1 - n) : n;
+    }
+
+    /** @brief Slot of the `n`th sample in iteration order. */
+    constexpr index_t slot_at(const index_t n) const noexcept {
+        return order.at(chrono(n), utilized);
+    }
+
+    /**
+     * @brief Chronological rank a sample with `timestamp` goes to, after any
+     * samples with an equal timestamp. Late samples usually land close to the
+     * newest, so search back from there: galloping, then binary, for orders
+     * with cheap rank lookups, O(log distance); a plain walk otherwise.
+     */
+    constexpr index_t upper_rank(const T_time& timestamp) const noexcept {
+        if constexpr (order_t::random_access) {
+            index_t lo = 0, hi = utilized;
+            for (std::size_t step = 1; step <= hi; step *= 2) {
+                const auto probe = static_cast<index_t>(hi - step);
+                if (timestamp < timestamps[order.at(probe, utilized)]) {
+                    hi = probe;
+                } else {
+                    lo = probe + 1;
+                    break;
+                }
+            }
+            while (lo < hi) {
+                const auto mid = static_cast<index_t>(lo + (hi - lo) / 2);
+                if (timestamp < timestamps[order.at(mid, utilized)]) {
+                    hi = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            return lo;
+        } else {
+            index_t r = utilized;
+            for (auto c = order.seek(r - 1, utilized); r > 0 && timestamp < timestamps[order.slot(c)]; c = order.prev(c)) {
+                --r;
+            }
+            return r;
+        }
+    }
+
+    /**
+     * @brief Chronological rank of the first sample whose timestamp fails
+     * `pred`, which must hold for a (possibly empty) oldest part of the
+     * series only. Binary search for orders with cheap rank lookups, a walk
+     * from the oldest sample otherwise.
+     */
+    template <typename Pred>
+    constexpr index_t partition_rank(Pred&& pred) const noexcept {
+        if constexpr (order_t::random_access) {
+            index_t lo = 0, hi = utilized;
+            while (lo < hi) {
+                const auto mid = static_cast<index_t>(lo + (hi - lo) / 2);
+                if (pred(timestamps[order.at(mid, utilized)])) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        } else {
+            index_t r = 0;
+            for (auto c = order.seek(0, utilized); r < utilized && pred(timestamps[order.slot(c)]); c = order.next(c)) {
+                ++r;
+            }
+            return r;
+        }
+    }
+
+    /** @brief Chronological rank of the first sample at or after `t`. */
+    constexpr index_t lower_rank(const T_time& t) const noexcept {
+        return partition_rank([&t](const T_time& x) { return x < t; });
+    }
+
+    /** @brief Chronological rank of the first sample after `t`. */
+    constexpr index_t after_rank(const T_time& t) const noexcept {
+        return partition_rank([&t](const T_time& x) { return !(t < x); });
+    }
+
+    /** @brief Write just the value of `slot`, see `store(...)`. */
+    template <typename V>
+    constexpr void write_value(const index_t slot, const bool fresh, V&& val) noexcept(nothrow_store<V>) {
+        if constexpr (values_t::deferred) {
+            values.write(slot, fresh, std::forward<V>(val));
+        } else {
+            sts::detail::put(values[slot], std::forward<V>(val));
+        }
+    }
+
+    /** @brief Whether storing a `V` as value, see `store(...)`, cannot throw. */
+    template <typename V>
+    static constexpr bool nothrow_store = sts::detail::nothrow_write<T_value, V>::value;
+
+    /**
+     * @brief Write a sample to `slot` and update the indices. `fresh` slots
+     * were unoccupied, others are overwritten after passing their sample to
+     * the eviction sink. `val` is copied, moved or, for an `emplacer`,
+     * constructed in place. Ordering is up to the caller. If writing the
+     * value throws, nothing else has changed yet and the sink was not
+     * called: with a sink, a value that may throw is built aside first and
+     * moved in after the sink had the old one, so moving it must not throw.
+     */
+    template <typename V, typename T, typename Sc>
+    constexpr void store(const index_t slot, const bool fresh, V&& val, const T& timestamp, const Sc& score) noexcept(nothrow_store<V>) {
+        if constexpr (nothrow_store<V> || std::is_same_v<decltype(sink), sts::detail::discard>) {
+            if (!fresh) sink(values[slot], timestamps[slot], scores[slot]);
+            write_value(slot, fresh, std::forward<V>(val));
+        } else if (fresh) {
+            write_value(slot, fresh, std::forward<V>(val));
+        } else {
+            // The sink may move the old value out, so it runs once the new
+            // one exists
+            auto replacement = sts::detail::make<T_value>(std::forward<V>(val));
+            sink(values[slot], timestamps[slot], scores[slot]);
+            write_value(slot, fresh, std::move(replacement));
+        }
+        if (!fresh) lookup.erase(slot, timestamps.data());
+        timestamps[slot] = timestamp;
+        scores[slot] = score;
+        fresh ? index.push(slot, scores.data()) : index.update(slot, scores.data());
+        top.update(slot, scores.data(), timestamps.data());
+        lookup.insert(slot, timestamps.data());
+        snapshots.mark(slot);
+    }
+
+    /**
+     * @brief Insert `K` samples (`get(k)` yields a `(value, timestamp, score)`
+     * tuple) as if inserted one by one: keep the best S of the stored and the
+     * new samples, then merge the new ones in chronologically.
+     * 
+     * Slots are overwritten during the merge, so values that may throw on
+     * copying are copied aside first: if one throws, nothing has changed.
+     * Values whose move may throw as well go one by one, so a throw leaves
+     * the samples before it inserted and the series consistent.
+     */
+    template <typename Get>
+    void _insert_many(const std::size_t K, Get&& get) {
+        using value_ref = decltype(std::get<VAL>(std::declval<const std::remove_reference_t<decltype(get(K))>&>()));
+        constexpr bool staged = !nothrow_store<value_ref>;
+        constexpr bool cheap_insert = decltype(index)::logarithmic && order_t::late_insert;
+        if (K == 0) return;
+        if (K == 1 || (staged && !nothrow_store<T_value>) || (cheap_insert && K * 256 <= utilized)) {
+            // A few samples go one by one, allocating nothing, where a late
+            // insert is O(log S): a heap index with a Fenwick order. With a
+            // scan, a dense order or a linked walk each could cost O(S).
+            for (std::size_t k = 0; k < K; ++k) {
+                const auto& sample = get(k);
+                _insert_one(std::get<VAL>(sample), std::get<TIM>(sample), std::get<SCO>(sample));
+            }
+            return;
+        }
+        T_time next_timestamp = last_timestamp_plus_one;
+        for (std::size_t k = 0; k < K; ++k) {
+            const T_time& t = std::get<TIM>(get(k));
+            if (t + 1 > next_timestamp) next_timestamp = t + 1;
+        }
+
+        // Select the samples to drop: the `D` worst of the union can only
+        // come from the `D` worst stored ones and the new ones. Ties drop
+        // stored samples (lowest slot first) before new ones (oldest first).
+        std::vector<char> keep(K, 1);
+        std::vector<index_t> victims;
+        const std::size_t cap = this->capacity();
+        if (utilized + K > cap) {
+            const std::size_t D = utilized + K - cap;
+            const std::size_t E = std::min<std::size_t>(D, utilized);
+            const auto worse_slot = [this](index_t a, index_t b) { return sts::detail::worse(scores.data(), a, b); };
+
+            std::vector<index_t> stored(utilized);
+            std::iota(stored.begin(), stored.end(), index_t{0});
+            if (E < stored.size()) std::nth_element(stored.begin(), stored.begin() + E, stored.end(), worse_slot);
+
+            // Pool entries: stored slot `i` as `i`, new sample `k` as `cap + k`
+            std::vector<std::size_t> pool(stored.begin(), stored.begin() + E);
+            for (std::size_t k = 0; k < K; ++k) pool.push_back(cap + k);
+            const auto score_of = [&](std::size_t p) -> T_score { return p < cap ? scores[p] : std::get<SCO>(get(p - cap)); };
+            std::nth_element(pool.begin(), pool.begin() + D - 1, pool.end(), [&](std::size_t a, std::size_t b) {
+                return score_of(a) > score_of(b) || (score_of(a) == score_of(b) && a < b);
+            });
+            for (std::size_t i = 0; i < D; ++i) {
+                if (pool[i] < cap) {
+                    victims.push_back(static_cast<index_t>(pool[i]));
+                } else {
+                    keep[pool[i] - cap] = 0;
+                }
+            }
+        }
+
+        std::vector<std::size_t> incoming;
+        for (std::size_t k = 0; k < K; ++k) {
+            if (keep[k]) incoming.push_back(k);
+        }
+        if (incoming.empty()) {
+            last_timestamp_plus_one = next_timestamp;
+            return;
+        }
+        std::stable_sort(incoming.begin(), incoming.end(), [&](std::size_t a, std::size_t b) {
+            return std::get<TIM>(get(a)) < std::get<TIM>(get(b));
+        });
+        std::vector<T_value> copies;
+        if constexpr (staged) {
+            copies.reserve(incoming.size());
+            for (const auto k : incoming) copies.push_back(sts::detail::make<T_value>(std::get<VAL>(get(k))));
+        }
+
+        // Chronological merge of the remaining stored and the incoming samples
+        std::vector<char> evicted(cap, 0);
+        for (const auto v : victims) evicted[v] = 1;
+        std::vector<index_t> seq;
+        seq.reserve(utilized - victims.size() + incoming.size());
+        auto next_slot = victims.begin();
+        index_t fresh = utilized;
+        auto in = incoming.begin();
+        const auto take_incoming = [&]() {
+            const auto& sample = get(*in);
+            const bool reuse = fresh == cap;
+            const index_t slot = reuse ? *next_slot++ : fresh++;
+            if constexpr (staged) {
+                store(slot, !reuse, std::move(copies[in - incoming.begin()]), std::get<TIM>(sample), std::get<SCO>(sample));
+            } else {
+                store(slot, !reuse, std::get<VAL>(sample), std::get<TIM>(sample), std::get<SCO>(sample));
+            }
+            ++in;
+            seq.push_back(slot);
+        };
+        auto c = order.seek(0, utilized);
+        for (index_t r = 0; r < utilized; ++r, c = order.next(c)) {
+            const auto slot = order.slot(c);
+            if (evicted[slot]) continue;
+            while (in != incoming.end() && std::get<TIM>(get(*in)) < timestamps[slot]) take_incoming();
+            seq.push_back(slot);
+        }
+        while (in != incoming.end()) take_incoming();
+
+        utilized = fresh;
+        last_timestamp_plus_one = next_timestamp;
+        order.assign(seq.data(), static_cast<index_t>(seq.size()));
+        snapshots.reorder();
+    }
+
+    /** @brief Append a sample, if it scores well enough. `val` is only
+               touched once it is known to be stored. */
+    template <typename V>
+    constexpr bool _add(V&& val, const T_time& timestamp, const T_score& score) noexcept(nothrow_store<V>) {
+        last_timestamp_plus_one = timestamp + 1;
+
+        if (utilized < this->capacity()) {
+            store(utilized, true, std::forward<V>(val), timestamp, score);
+            order.append(utilized, utilized);
+            snapshots.insert(utilized, utilized);
+
+            ++utilized;
+            return true;
+        } else {
+            if (utilized == 0) return false; // No capacity
+            const auto [wi, ws] = worst_index();
+            if (score <= ws) { // store newest element in case of same score
+                store(wi, false, std::forward<V>(val), timestamp, score);
+                order.move_to_back(wi, utilized);
+                snapshots.erase(wi);
+                snapshots.insert(wi, utilized - 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** @brief Insert a sample at its chronological place, if it scores well
+               enough. `val` is only touched once it is known to be stored. */
+    template <typename V>
+    constexpr bool _insert_one(V&& val, const T_time& timestamp, const T_score& score) noexcept(nothrow_store<V>) {
+        if (timestamp + 1 > last_timestamp_plus_one) {
+            last_timestamp_plus_one = timestamp + 1;
+        }
+
+        if (utilized < this->capacity()) {
+            const auto r = upper_rank(timestamp);
+            store(utilized, true, std::forward<V>(val), timestamp, score);
+            order.insert(utilized, r, utilized);
+            snapshots.insert(utilized, r);
+
+            ++utilized;
+            return true;
+
+        } else {
+            if (utilized == 0) return false; // No capacity
+            const auto [wi, ws] = worst_index();
+
+            if (score > ws) {
+                return false;
+            }
+
+            // Rank among the other samples: the victim still holds its old
+            // timestamp and is counted if it sorts before the new one.
+            const auto r = upper_rank(timestamp) - (timestamps[wi] <= timestamp);
+
+            store(wi, false, std::forward<V>(val), timestamp, score);
+            order.relocate(wi, static_cast<index_t>(r), utilized);
+            snapshots.erase(wi);
+            snapshots.insert(wi, r);
+            return true;
+        }
+    }
+
+    /** @brief Lower score, or equal score in a higher slot: the reverse of
+               the eviction order. */
+    constexpr bool better(const index_t a, const index_t b) const noexcept {
+        return sts::detail::worse(scores.data(), b, a);
+    }
+
+    /** @brief Sort slots into iteration order, by timestamp. */
+    constexpr void iteration_sort(index_t* slots, const index_t k) const noexcept {
+        std::sort(slots, slots + k, [this](index_t a, index_t b) {
+            return Reverse ? timestamps[b] < timestamps[a] || (timestamps[a] == timestamps[b] && b < a)
+                           : timestamps[a] < timestamps[b] || (timestamps[a] == timestamps[b] && a < b);
+        });
+    }
+
+    /**
+     * @brief Write the slots of the `k <= size()` best samples to `slots`, in
+     * no particular order. A max-heap of the `k` best so far, worst on top,
+     * so most slots cost a single compare against the top. The best one
+     * alone is O(1) from a score index that keeps it.
+     */
+    constexpr void select_best(index_t* slots, const index_t k) const noexcept {
+        if (k == 0) return;
+        if constexpr (decltype(index)::has_best) {
+            if (k == 1) {
+                slots[0] = index.best(scores.data(), utilized);
+                return;
+            }
+        }
+        const auto cmp = [this](index_t a, index_t b) { return better(a, b); };
+        std::iota(slots, slots + k, index_t{0});
+        std::make_heap(slots, slots + k, cmp);
+        for (index_t i = k; i < utilized; ++i) {
+            if (better(i, slots[0])) {
+                std::pop_heap(slots, slots + k, cmp);
+                slots[k - 1] = i;
+                std::push_heap(slots, slots + k, cmp);
+            }
+        }
+    }
+
+    /** @brief Whether the `k` best samples are kept by the best-K policy. */
+    static constexpr bool tracked(const std::size_t k) noexcept {
+        return k <= top_k_t::K;
+    }
+
+    /**
+     * @brief Write the slots of the `k <= size()` best samples to `slots`, in
+     * iteration order: O(K) from the best-K policy if it covers `k`, after
+     * selecting its set again if it went invalid, O(S log k) otherwise.
+     */
+    constexpr void best_slots(index_t* slots, const index_t k) const noexcept {
+        if (k == 0) return;
+        if constexpr (top_k_t::K > 0) {
+            if (tracked(k)) {
+                if (!top.valid || top.size < k) {
+                    const auto n = static_cast<index_t>(std::min<std::size_t>(top_k_t::cap, utilized));
+                    select_best(top.slots.data(), n);
+                    top.assign(n, scores.data(), timestamps.data(), n == utilized);
+                }
+                top.select(slots, k, scores.data());
+                if constexpr (Reverse) std::reverse(slots, slots + k);
+                return;
+            }
+        }
+        select_best(slots, k);
+        iteration_sort(slots, k);
+    }
+
+    template <std::size_t N, std::size_t... Is>
+    constexpr std::array<std::tuple<T_value&, T_time&, T_score&>, N> refs(const std::array<index_t, N>& slots, std::index_sequence<Is...>) noexcept {
+        return {{ std::forward_as_tuple(values[slots[Is]], timestamps[slots[Is]], scores[slots[Is]])... }};
+    }
+
+    /**
+     * @brief Iterator over the samples in iteration order, dereferencing to a
+     * `(value&, timestamp&, score&)` tuple. Steps follow the order's cursors;
+     * jumps, `[]` and `end() - 1` seek, which is cheap for orders with
+     * `random_access` ranks. Like `std::vector<bool>::iterator` it claims
+     * the random access category for such orders despite its proxy
+     * reference, so the standard algorithms take their fast paths. The
+     * value type is a tuple of copies, so `value_type v = *it` does not
+     * alias the slot.
+     */
+    template <bool Const>
+    class basic_iterator {
+        using series_t = std::conditional_t<Const, const selective_time_series, selective_time_series>;
+        using cursor = typename order_t::cursor;
+        template <typename U>
+        using ref = std::conditional_t<Const, const U&, U&>;
+        friend class selective_time_series;
+        friend class basic_iterator<!Const>;
+    public:
+        using iterator_concept  = std::conditional_t<order_t::random_access, std::random_access_iterator_tag, std::bidirectional_iterator_tag>;
+        using iterator_category = iterator_concept;
+        using reference         = sts::detail::sample_ref<ref<T_value>, ref<T_time>, ref<T_score>>;
+        using value_type        = std::tuple<T_value, T_time, T_score>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+
+        constexpr basic_iterator() noexcept = default;
+        /** @brief `iterator` to `const_iterator`. */
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        constexpr basic_iterator(const basic_iterator<false>& other) noexcept : series{other.series}, i{other.i}, c{other.c} {}
+
+        constexpr reference operator*() const noexcept {
+            const auto o = series->order.slot(c);
+            return { series->values[o], series->timestamps[o], series->scores[o] };
+        }
+        constexpr reference operator[](const difference_type n) const noexcept { return *(*this + n); }
+
+        constexpr basic_iterator& operator++() noexcept {
+            ++i;
+            c = Reverse ? series->order.prev(c) : series->order.next(c);
+            return *this;
+        }
+        constexpr basic_iterator& operator--() noexcept {
+            // Past the end the cursor may not lead back, so seek
+            if (i-- == series->utilized) return seek();
+            c = Reverse ? series->order.next(c) : series->order.prev(c);
+            return *this;
+        }
+        constexpr basic_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+        constexpr basic_iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+        constexpr basic_iterator& operator+=(const difference_type n) noexcept {
+            i = static_cast<index_t>(i + n);
+            return seek();
+        }
+        constexpr basic_iterator& operator-=(const difference_type n) noexcept { return *this += -n; }
+
+        friend constexpr basic_iterator operator+(basic_iterator it, const difference_type n) noexcept { return it += n; }
+        friend constexpr basic_iterator operator+(const difference_type n, basic_iterator it) noexcept { return it += n; }
+        friend constexpr basic_iterator operator-(basic_iterator it, const difference_type n) noexcept { return it -= n; }
+        friend constexpr difference_type operator-(const basic_iterator& a, const basic_iterator& b) noexcept {
+            return static_cast<difference_type>(a.i) - static_cast<difference_type>(b.i);
+        }
+
+        friend constexpr bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept { return a.i == b.i; }
+        friend constexpr bool operator!=(const basic_iterator& a, const basic_iterator& b) noexcept { return a.i != b.i; }
+        friend constexpr bool operator< (const basic_iterator& a, const basic_iterator& b) noexcept { return a.i <  b.i; }
+        friend constexpr bool operator> (const basic_iterator& a, const basic_iterator& b) noexcept { return a.i >  b.i; }
+        friend constexpr bool operator<=(const basic_iterator& a, const basic_iterator& b) noexcept { return a.i <= b.i; }
+        friend constexpr bool operator>=(const basic_iterator& a, const basic_iterator& b) noexcept { return a.i >= b.i; }
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+        friend constexpr auto operator<=>(const basic_iterator& a, const basic_iterator& b) noexcept { return a.i <=> b.i; }
+#endif
+    private:
+        constexpr basic_iterator(series_t& ts, const index_t _i) noexcept : series{&ts}, i{_i} { seek(); }
+
+        constexpr basic_iterator& seek() noexcept {
+            c = series->order.seek(i < series->utilized ? series->chrono(i) : series->utilized, series->utilized);
+            return *this;
+        }
+
+        series_t* series {nullptr};
+        index_t i {0};
+        cursor c {};
+    };
+
+    /** @brief A run of consecutive samples, in iteration order. */
+    template <typename It>
+    class basic_view {
+    public:
+        constexpr basic_view(It _first, It _last) noexcept : first{_first}, last{_last} {}
+        /** @brief `view` to `const_view`. */
+        template <typename Other, typename = std::enable_if_t<std::is_convertible_v<Other, It>>>
+        constexpr basic_view(const basic_view<Other>& other) noexcept : first{other.begin()}, last{other.end()} {}
+        constexpr It      begin() const noexcept { return first; }
+        constexpr It      end()   const noexcept { return last; }
+        constexpr index_t size()  const noexcept { return static_cast<index_t>(last - first); }
+        constexpr bool    empty() const noexcept { return first == last; }
+    private:
+        It first;
+        It last;
+    };
+
+public:
+    /** @brief Iterator, dereferences to `(value&, timestamp&, score&)`. */
+    using iterator = basic_iterator<false>;
+
+    /** @brief Iterator over a const series. */
+    using const_iterator = basic_iterator<true>;
+
+    /** @brief Result of `range(...)`. */
+    using view = basic_view<iterator>;
+    using const_view = basic_view<const_iterator>;
+
+private:
+    /** @brief Iterator at position `n` (as for `operator[]`), `end()` for
+               `n == size()`. */
+    constexpr iterator iterator_at(const index_t n) noexcept {
+        return { *this, n };
+    }
+
+public:
+    /** @brief Type of element.value */
+    using value_type = T_value;
+
+    /** @brief Iteration order, true if newest first. */
+    static constexpr bool reverse = Reverse;
+
+    /** @brief Type of element.timestamp */
+    using time_type = T_time;
+
+    /** @brief Type of element.score */
+    using score_type = T_score;
+
+    /** @brief Allocator used for the columns of a `sts::dynamic` series. */
+    using allocator_type = alloc_t;
+
+    constexpr selective_time_series() : selective_time_series(S) {
+        static_assert(S != sts::dynamic, "Pass the capacity of a dynamic series to the constructor");
+    }
+
+    /**
+     * @brief Construct a series holding up to `capacity` samples. For a fixed
+     * `S` capacity must equal `S`, for `sts::dynamic` all columns are
+     * allocated once, here, through `alloc`.
+     * 
+     * @param  capacity     Samples to store
+     * @param  alloc        Allocator, rebound for each column
+     * @throws std::invalid_argument    `capacity` differs from a fixed `S`
+     * @throws std::length_error        `capacity` does not fit the slot
+     *                                  index of a dynamic series
+     */
+    constexpr explicit selective_time_series(std::size_t capacity, const allocator_type& alloc = allocator_type())
+        : sts::detail::extent<S>(checked(capacity)),
+          values(capacity, alloc), timestamps(capacity, alloc), scores(capacity, alloc),
+          index(capacity, alloc), order(capacity, alloc), lookup(capacity, alloc), snapshots(capacity) {}
+
+    selective_time_series(const selective_time_series&) = default;
+    selective_time_series& operator=(const selective_time_series&) = default;
+
+    /** @brief Take over the samples of `other`, which is left empty. A
+               dynamic `other` lost its storage and has capacity 0. */
+    selective_time_series(selective_time_series&& other) noexcept(nothrow_move)
+        : sts::detail::extent<S>(other),
+          values(std::move(other.values)), timestamps(std::move(other.timestamps)), scores(std::move(other.scores)),
+          index(std::move(other.index)), order(std::move(other.order)), lookup(std::move(other.lookup)),
+          snapshots(std::move(other.snapshots)), sink(std::move(other.sink)), top(std::move(other.top)),
+          utilized{other.utilized}, last_timestamp_plus_one{other.last_timestamp_plus_one}, dirty{other.dirty} {
+        other.vacate();
+    }
+    selective_time_series& operator=(selective_time_series&& other) noexcept(nothrow_move) {
+        if (this != &other) {
+            static_cast<sts::detail::extent<S>&>(*this) = other;
+            values = std::move(other.values);
+            timestamps = std::move(other.timestamps);
+            scores = std::move(other.scores);
+            index = std::move(other.index);
+            order = std::move(other.order);
+            lookup = std::move(other.lookup);
+            snapshots = std::move(other.snapshots);
+            sink = std::move(other.sink);
+            top = std::move(other.top);
+            utilized = other.utilized;
+            last_timestamp_plus_one = other.last_timestamp_plus_one;
+            dirty = other.dirty;
+            other.vacate();
+        }
+        return *this;
+    }
+
+    /** @brief Maximum amount of samples stored. */
+    using sts::detail::extent<S>::capacity;
+
+    /** @brief The eviction sink, e.g. to point it at its destination. */
+    constexpr auto& eviction_sink() noexcept { return sink; }
+
+    /** @brief Count of unscored samples added. User is responsible for
+               resetting after scoring. */
+    index_t dirty { 0 };
+
+    /**
+     * @brief Return the amount of samples currently stored.
+     * 
+     * @return index_t Samples 
+     */
+    constexpr auto size() const noexcept {
+        return utilized;
+    }
+
+    /**
+     * @brief Add a sample to the dataset with "last time + 1" as timestamp, a
+     * max score and increment the dirty counter.
+     * 
+     * @param  val      Sample to add
+     * @return index_t  dirty count
+     */
+    constexpr auto add(const T_value& val) noexcept(nothrow_store<const T_value&>) {
+        dirty += _add(val, last_timestamp_plus_one++, 0);
+        return dirty;
+    }
+    /**
+     * @brief Add a sample to the dataset with `timestamp` as timestamp, a max
+     * score and increment the dirty counter.
+     * 
+     * @param  val          Sample to add
+     * @param  timestamp    Timestamp for sample
+     * @return index_t      Dirty count
+     */
+    constexpr auto add(const T_value& val, const T_time& timestamp) noexcept(nothrow_store<const T_value&>) {
+        dirty += _add(val, timestamp, 0);
+        return dirty;
+    }
+    /**
+     * @brief Add a scored sample to the dataset, dirty counter is not increased.
+     * 
+     * @param  val          Sample to add
+     * @param  timestamp    Timestamp for sample
+     * @param  score        Score for sample
+     * @return index_t      Dirty count
+     */
+    constexpr auto add(const T_value& val, const T_time& timestamp, const T_score& score) noexcept(nothrow_store<const T_value&>) {
+        _add(val, timestamp, score);
+        return dirty;
+    }
+    /** @brief `add(...)` moving `val` in, if stored. */
+    constexpr auto add(T_value&& val) noexcept(nothrow_store<T_value>) {
+        dirty += _add(std::move(val), last_timestamp_plus_one++, 0);
+        return dirty;
+    }
+    /** @brief `add(...)` moving `val` in, if stored. */
+    constexpr auto add(T_value&& val, const T_time& timestamp) noexcept(nothrow_store<T_value>) {
+        dirty += _add(std::move(val), timestamp, 0);
+        return dirty;
+    }
+    /** @brief `add(...)` moving `val` in, if stored. */
+    constexpr auto add(T_value&& val, const T_time& timestamp, const T_score& score) noexcept(nothrow_store<T_value>) {
+        _add(std::move(val), timestamp, score);
+        return dirty;
+    }
+
+    /**
+     * @brief Add a scored sample, constructing the value from `args` directly
+     * in its slot. The score is checked first, so nothing is constructed for
+     * a rejected sample.
+     * 
+     * @param  timestamp    Timestamp for sample
+     * @param  score        Score for sample
+     * @param  args         Arguments to construct the value from
+     * @return bool         Stored
+     */
+    template <typename... Args>
+    constexpr bool emplace(const T_time& timestamp, const T_score& score, Args&&... args) noexcept(nothrow_store<sts::detail::emplacer<Args...>>) {
+        return _add(sts::detail::emplacer<Args...>{ std::forward_as_tuple(std::forward<Args>(args)...) }, timestamp, score);
+    }
+
+    /**
+     * @brief Add `n` scored samples, with the same end result as calling
+     * `add(vals[i], times[i], scores[i])` for each in turn. Once full, the
+     * worst score can only improve, so every sample scoring worse than the
+     * current worst is dropped in a branch-free pass before any is stored.
+     * If a value throws, the samples before it stay added.
+     * 
+     * @param  vals     Samples to add
+     * @param  times    Timestamps for the samples
+     * @param  scs      Scores for the samples
+     * @param  n        Amount of samples
+     * @return index_t  Dirty count
+     */
+    constexpr auto add_batch(const T_value* vals, const T_time* times, const T_score* scs, const std::size_t n) noexcept(nothrow_store<const T_value&>) {
+        std::size_t i = 0;
+        for (; i < n && utilized < this->capacity(); ++i) {
+            _add(vals[i], times[i], scs[i]);
+        }
+
+        constexpr std::size_t chunk = 256;
+        std::array<bool, chunk> pass {};
+        for (; i < n && utilized > 0; i += chunk) {
+            const auto m = std::min(chunk, n - i);
+            const T_score threshold = std::get<1>(worst_index());
+            for (std::size_t j = 0; j < m; ++j) {
+                pass[j] = !(scs[i + j] > threshold);
+            }
+            for (std::size_t j = 0; j < m; ++j) {
+                if (pass[j]) _add(vals[i + j], times[i + j], scs[i + j]);
+            }
+        }
+
+        if (n) last_timestamp_plus_one = times[n - 1] + 1;
+        return dirty;
+    }
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+    /** @brief `add_batch(...)` over equally sized spans. */
+    constexpr auto add_batch(std::span<const T_value> vals, std::span<const T_time> times, std::span<const T_score> scs) noexcept(nothrow_store<const T_value&>) {
+        return add_batch(vals.data(), times.data(), scs.data(), std::min({ vals.size(), times.size(), scs.size() }));
+    }
+#endif
+
+    /**
+     * @brief Position (as for `operator[]`) a sample with `timestamp` would be
+     * inserted at. Samples with an equal timestamp are considered older.
+     * 
+     * @param  timestamp    Timestamp to locate
+     * @return index_t      Position
+     */
+    constexpr auto insertion_offset(const T_time& timestamp) const noexcept {
+        const auto r = upper_rank(timestamp);
+        return Reverse ? static_cast<index_t>(utilized - r) : r;
+    }
+
+    /**
+     * @brief First sample, in iteration order, not before `timestamp`: the
+     * oldest at or after it, or with `Reverse` the newest at or before it.
+     * O(log S) for orders with cheap rank lookups, O(S) for
+     * `sts::linked_order`.
+     * 
+     * @param  timestamp    Timestamp to locate
+     * @return iterator     Sample, or `end()`
+     */
+    constexpr iterator lower_bound(const T_time& timestamp) noexcept {
+        return iterator_at(Reverse ? static_cast<index_t>(utilized - after_rank(timestamp)) : lower_rank(timestamp));
+    }
+    constexpr const_iterator lower_bound(const T_time& timestamp) const noexcept {
+        return const_cast<selective_time_series&>(*this).lower_bound(timestamp);
+    }
+
+    /**
+     * @brief First sample, in iteration order, after `timestamp`: the oldest
+     * after it, or with `Reverse` the newest before it. Costs as
+     * `lower_bound(...)`.
+     * 
+     * @param  timestamp    Timestamp to locate
+     * @return iterator     Sample, or `end()`
+     */
+    constexpr iterator upper_bound(const T_time& timestamp) noexcept {
+        return iterator_at(Reverse ? static_cast<index_t>(utilized - lower_rank(timestamp)) : after_rank(timestamp));
+    }
+    constexpr const_iterator upper_bound(const T_time& timestamp) const noexcept {
+        return const_cast<selective_time_series&>(*this).upper_bound(timestamp);
+    }
+
+    /**
+     * @brief All samples with `t0 <= timestamp < t1`, in iteration order.
+     * Both ends are found by binary search, so walking the `k` samples costs
+     * O(log S + k) for orders with cheap rank lookups.
+     * 
+     * @param  t0       First timestamp included
+     * @param  t1       First timestamp excluded
+     * @return view     `begin()`, `end()` and `size()` of the samples
+     */
+    constexpr view range(const T_time& t0, const T_time& t1) noexcept {
+        const auto lo = lower_rank(t0);
+        const auto hi = std::max(lo, lower_rank(t1));
+        if constexpr (Reverse) {
+            return { iterator_at(static_cast<index_t>(utilized - hi)), iterator_at(static_cast<index_t>(utilized - lo)) };
+        } else {
+            return { iterator_at(lo), iterator_at(hi) };
+        }
+    }
+    constexpr const_view range(const T_time& t0, const T_time& t1) const noexcept {
+        return const_cast<selective_time_series&>(*this).range(t0, t1);
+    }
+
+    /**
+     * @brief Sample with the timestamp closest to `timestamp`, the older one
+     * of two equally close. Costs as `lower_bound(...)`.
+     * 
+     * @param  timestamp    Timestamp to look for
+     * @return iterator     Sample, or `end()` if the series is empty
+     */
+    constexpr iterator nearest(const T_time& timestamp) noexcept {
+        if (utilized == 0) return end();
+        auto r = lower_rank(timestamp);
+        if (r == utilized || (r > 0 && timestamp - timestamps[order.at(r - 1, utilized)] <= timestamps[order.at(r, utilized)] - timestamp)) --r;
+        return iterator_at(chrono(r));
+    }
+    constexpr const_iterator nearest(const T_time& timestamp) const noexcept {
+        return const_cast<selective_time_series&>(*this).nearest(timestamp);
+    }
+
+    /**
+     * @brief Check whether a sample with exactly this value, timestamp and
+     * score is stored. O(1) with `sts::timestamp_hash`, a scan otherwise.
+     * 
+     * @param  elem     `(value, timestamp, score)` to look for
+     * @return bool     Found
+     */
+    constexpr bool has(const std::tuple<const T_value&, const T_time&, const T_score&>& elem) const noexcept {
+        const auto matches = [&](index_t i) {
+            return timestamps[i] == std::get<TIM>(elem) && scores[i] == std::get<SCO>(elem) && values[i] == std::get<VAL>(elem);
+        };
+        if constexpr (decltype(lookup)::enabled) {
+            return utilized > 0 && lookup.find(std::get<TIM>(elem), timestamps.data(), matches) != decltype(lookup)::nil;
+        } else {
+            for (index_t i = 0; i < utilized; ++i) {
+                if (matches(i)) return true;
+            }
+            return false;
+        }
+    }
+
+    /**
+     * @brief Like `add(...)`, but instead of assuming the timestamp is always
+     * newest, inserts at the proper location. More expensive.
+     * 
+     * @param  elem     `(value, timestamp, score)` to insert
+     * @return bool     Stored
+     */
+    constexpr bool insert_one(const std::tuple<const T_value&, const T_time&, const T_score&>&& elem) noexcept(nothrow_store<const T_value&>) {
+        return _insert_one(std::get<VAL>(elem), std::get<TIM>(elem), std::get<SCO>(elem));
+    }
+    /** @brief `insert_one(...)` for any `(value, timestamp, score)` tuple,
+               moving the value in if the tuple holds it by value or by
+               rvalue reference, and it is stored. */
+    template <typename... Ts>
+    constexpr bool insert_one(std::tuple<Ts...>&& elem) noexcept(nothrow_store<decltype(std::get<VAL>(std::move(elem)))>) {
+        return _insert_one(std::get<VAL>(std::move(elem)), std::get<TIM>(elem), std::get<SCO>(elem));
+    }
 
-    index_t utilized {0};
-    T_time last_timestamp_plus_one {0};
+    /**
+     * @brief Insert several `(value, timestamp, score)` tuples at their proper
+     * location, with the same result as calling `insert_one(...)` on each in
+     * turn (up to which of equally scored samples is kept).
+     */
+    template <typename... Ts>
+    void insert_multiple(const Ts& ...sample) {
+        using ref_t = std::tuple<const T_value&, const T_time&, const T_score&>;
+        const std::array<ref_t, sizeof...(Ts)> items { ref_t(sample)... };
+        insert_range(items.begin(), items.end());
+    }
 
-    constexpr std::tuple<index_t, T_score> worst_index() noexcept {
-        const auto r = std::max_element(scores.begin(), scores.end());
-        return { std::distance(scores.begin(), r), *r };
+    /**
+     * @brief Like `insert_multiple(...)`, for a runtime sized range. Elements
+     * must dereference to `(value, timestamp, score)` tuples of references
+     * (or be stored in the range). The K worst victims are selected in one
+     * pass over the scores and the chronological order is rebuilt in one
+     * pass: O(S + K log K) rather than K times O(S). A single sample, or a
+     * few compared to S with a heap index and a Fenwick order, are inserted
+     * one by one instead.
+     * 
+     * If copying a value throws, the series is left as it was. Values whose
+     * move may throw too are inserted one by one, so the samples before the
+     * throwing one stay inserted.
+     * 
+     * @param  first    Start of the range
+     * @param  last     End of the range
+     */
+    template <typename It>
+    void insert_range(It first, It last) {
+        std::vector<It> items;
+        for (; first != last; ++first) items.push_back(first);
+        _insert_many(items.size(), [&](std::size_t k) -> decltype(auto) { return *items[k]; });
     }
 
-    constexpr index_t find_offset_index(index_t in) {
-        for (index_t i = 0; i < S; ++i) {
-            if (offsets[i] == in) return i;
-        }
-        return S;
+    constexpr decltype(auto) insert(const T_value& val, const T_time& timestamp, const T_score& score) {
+        return _insert_one(val, timestamp, score);
+    }
+    constexpr decltype(auto) insert(T_value&& val, const T_time& timestamp, const T_score& score) {
+        return _insert_one(std::move(val), timestamp, score);
     }
 
-    constexpr bool _add(const T_value& val, const T_time& timestamp, const T_score& score) noexcept {
-        last_timestamp_plus_one = timestamp + 1;
+    /**
+     * @brief Like `emplace(...)`, inserting at the proper location.
+     * 
+     * @param  timestamp    Timestamp for sample
+     * @param  score        Score for sample
+     * @param  args         Arguments to construct the value from
+     * @return bool         Stored
+     */
+    template <typename... Args>
+    constexpr bool emplace_insert(const T_time& timestamp, const T_score& score, Args&&... args) noexcept(nothrow_store<sts::detail::emplacer<Args...>>) {
+        return _insert_one(sts::detail::emplacer<Args...>{ std::forward_as_tuple(std::forward<Args>(args)...) }, timestamp, score);
+    }
 
-        if (utilized < S) {
-            values[utilized] = val;
-            timestamps[utilized] = timestamp;
-            scores[utilized] = score;
+    /**
+     * @brief Insert all samples of `other` not already stored here. Both series
+     * are walked chronologically in step to drop exact duplicates, then the
+     * rest goes through one `insert_range(...)` style batch: O(S + N log N)
+     * instead of a search and a shift per sample. Assumes both series are in
+     * timestamp order, as `insert(...)` does. A throwing value leaves the
+     * series as `insert_range(...)` does.
+     * 
+     * @param  other    Series to merge in, left untouched
+     */
+    template <typename T, typename U, typename V, std::size_t N, bool B, typename... Ps>
+    void merge(const selective_time_series<T,N,B,U,V,Ps...>& other) {
+        std::vector<std::size_t> kept;
+        kept.reserve(other.utilized);
 
-            ++utilized;
-            return true;
-        } else {
-            const auto [wi, ws] = worst_index();
-            if (score <= ws) { // store newest element in case of same score
-                values[wi] = val;
-                timestamps[wi] = timestamp;
-                scores[wi] = score;
-
-                const auto oi = find_offset_index(wi);
-                if constexpr (Reverse) {
-                    std::move(offsets.begin(), offsets.begin() + oi, offsets.begin() + 1);
-                    offsets[0] = wi;
-                } else {
-                    // std::rotate generates a huge amount of extra assembly,
-                    // something fishy going on there.
-                    std::move(offsets.begin() + oi + 1, offsets.end(), offsets.begin() + oi);
-                    offsets[S-1] = wi;
-                }
-                return true;
+        index_t r = 0;
+        auto mine = order.seek(0, utilized);
+        auto theirs = other.order.seek(0, other.utilized);
+        std::size_t group = 0; // First of the kept samples sharing the current timestamp
+        for (std::size_t i = 0; i < other.utilized; ++i, theirs = other.order.next(theirs)) {
+            const auto o = other.order.slot(theirs);
+            const auto& t = other.timestamps[o];
+            while (r < utilized && timestamps[order.slot(mine)] < t) {
+                ++r;
+                mine = order.next(mine);
+            }
+
+            bool duplicate = false;
+            auto c = mine;
+            for (index_t q = r; !duplicate && q < utilized && !(t < timestamps[order.slot(c)]); ++q, c = order.next(c)) {
+                const auto m = order.slot(c);
+                duplicate = values[m] == other.values[o] && scores[m] == other.scores[o];
+            }
+            if (!kept.empty() && other.timestamps[kept.back()] != t) group = kept.size();
+            for (std::size_t j = group; !duplicate && j < kept.size(); ++j) {
+                duplicate = other.values[kept[j]] == other.values[o] && other.scores[kept[j]] == other.scores[o];
             }
+            if (!duplicate) kept.push_back(o);
         }
-        return false;
+
+        _insert_many(kept.size(), [&](std::size_t k) {
+            const auto o = kept[k];
+            return std::forward_as_tuple(other.values[o], other.timestamps[o], other.scores[o]);
+        });
     }
 
-    class iterator {
-    public:
-        using value_type = T_value;
-        constexpr iterator(selective_time_series& ts, const index_t _i = 0) noexcept : series{ts}, i{_i} {}
-        constexpr iterator& operator++()       noexcept { ++i; return *this; }
-        constexpr bool      operator!=(const iterator& other) const noexcept { return i != other.i; }
-        constexpr auto      operator* () const noexcept { return std::forward_as_tuple(series.values[series.offsets[i]], series.timestamps[series.offsets[i]], series.scores[series.offsets[i]]); }
-        constexpr auto      operator* ()       noexcept { return std::forward_as_tuple(series.values[series.offsets[i]], series.timestamps[series.offsets[i]], series.scores[series.offsets[i]]); }
-    private:
-        selective_time_series& series;
-        index_t i;
-    };
+    /** @brief shorthand for `add(const T_value& val)` */
+    constexpr auto& operator+=(const T_value& val) noexcept(nothrow_store<const T_value&>) { add(val); return this; }
 
-public:
-    /** @brief Type of element.value */
-    using value_type = T_value;
+    /** @brief The worst scoring sample, the one the next add competes with.
+               The series must not be empty. */
+    constexpr auto worst() noexcept {
+        assert(utilized > 0 && "worst() of an empty series");
+        const auto [ wi, ws ] = worst_index();
+        return std::forward_as_tuple(values[wi], timestamps[wi], scores[wi]);
+    }
 
-    constexpr selective_time_series() {
-        for (index_t i = 0; i < S; ++i) {
-            if constexpr (Reverse) {
-                offsets[i] = (S-1) - i;
-            } else {
-                offsets[i] = i;
-            }
-        }
+    /** @brief The best scoring sample, the counterpart of `worst()`. O(1)
+               with `sts::minmax_heap`, a scan otherwise. The series must not
+               be empty. */
+    constexpr auto best() noexcept {
+        assert(utilized > 0 && "best() of an empty series");
+        index_t bi = 0;
+        best_slots(&bi, utilized ? 1 : 0);
+        return std::forward_as_tuple(values[bi], timestamps[bi], scores[bi]);
     }
 
-    /** @brief Count of unscored samples added. User is responsible for
-               resetting after scoring. */
-    index_t dirty { 0 };
+    /**
+     * @brief Change the score of the `n`th sample (in iteration order) and
+     * keep the score index consistent. Prefer this over writing through the
+     * references returned by `[]` when using `sts::worst_cached`,
+     * `sts::worst_heap` or `sts::minmax_heap`.
+     * 
+     * @param  n        Sample position, as for `operator[]`
+     * @param  score    New score
+     */
+    constexpr void rescore(const index_t n, const T_score& score) noexcept {
+        const auto o = slot_at(n);
+        scores[o] = score;
+        index.update(o, scores.data());
+        top.update(o, scores.data(), timestamps.data());
+        snapshots.mark(o);
+    }
 
     /**
-     * @brief Return the amount of samples currently stored.
+     * @brief Rebuild the score index and timestamp lookup after samples were
+     * modified in place, e.g. through the references returned by `[]` or the
+     * iterator, and have the next `snapshot()` copy everything. A no-op for
+     * the default policies.
+     */
+    constexpr void reindex() noexcept {
+        index.rebuild(scores.data(), utilized);
+        lookup.rebuild(timestamps.data(), utilized);
+        top.invalidate();
+        snapshots.mark_all();
+    }
+
+    /**
+     * @brief Return references to the N best scoring samples, in iteration
+     * order. At least N samples must be stored, there is nothing to refer to
+     * otherwise (with `sts::slab_values` not even storage): use
+     * `best(n, out)`, which returns the count, on a series still filling up.
+     * O(K) with `sts::top_k<K>` and `N <= K`.
      * 
-     * @return index_t Samples 
+     * @tparam N                        Result size
+     * @return std::array<element, N>   `(value, timestamp, score)` references
      */
-    constexpr auto size() const noexcept {
-        return utilized;
+    template <index_t N>
+    constexpr std::array<std::tuple<T_value&, T_time&, T_score&>, N> best() noexcept {
+        static_assert(N <= S, "Can't select more 'best' elements than S");
+        assert(utilized >= N && "best<N>() of a series holding fewer than N samples");
+        std::array<index_t, N> slots {};
+        best_slots(slots.data(), utilized < N ? utilized : N);
+        return refs(slots, std::make_index_sequence<N>{});
     }
 
     /**
-     * @brief Add a sample to the dataset with "last time + 1" as timestamp, a
-     * max score and increment the dirty counter.
+     * @brief Write references to the, at most, `n` best scoring samples to
+     * `out`, in iteration order. Selection keeps a bounded heap of `n` slots
+     * for small `n`, O(S log n), or partitions all slots, O(S), otherwise.
+     * With `sts::top_k<K>` and `n <= K` it is O(K).
      * 
-     * @param  val      Sample to add
-     * @return index_t  dirty count
+     * @param  n            Samples wanted
+     * @param  out          Output iterator taking `(value, timestamp, score)`
+     *                      reference tuples
+     * @return std::size_t  Samples written, min(n, size())
      */
-    constexpr auto add(const T_value& val) noexcept {
-        dirty += _add(val, last_timestamp_plus_one++, 0);
-        return dirty;
+    template <typename OutIt>
+    std::size_t best(const std::size_t n, OutIt out) {
+        const auto k = static_cast<index_t>(std::min<std::size_t>(n, utilized));
+        std::vector<index_t> slots;
+        if (tracked(k) || std::size_t{k} * 8 < utilized) {
+            slots.resize(k);
+            best_slots(slots.data(), k);
+        } else {
+            slots.resize(utilized);
+            std::iota(slots.begin(), slots.end(), index_t{0});
+            std::nth_element(slots.begin(), slots.begin() + k, slots.end(), [this](index_t a, index_t b) { return better(a, b); });
+            slots.resize(k);
+            iteration_sort(slots.data(), k);
+        }
+        for (const auto o : slots) *out++ = std::forward_as_tuple(values[o], timestamps[o], scores[o]);
+        return k;
     }
+
     /**
-     * @brief Add a sample to the dataset with `timestamp` as timestamp, a max
-     * score and increment the dirty counter.
+     * @brief Immutable copy of the series, readable from any thread while
+     * this one changes. Requires `sts::cow_snapshots<C>`. Only chunks of `C`
+     * slots written since the previous snapshot are copied, the others are
+     * shared with it. The chronological order is kept in pieces of at most
+     * `C` slots, of which only those changed since are copied. A snapshot
+     * costs O(C) per changed chunk or piece and O(S/C) for the tables of
+     * both. After many changes, or `insert_range(...)` and `merge(...)`, the
+     * order is walked once instead, O(S).
      * 
-     * @param  val          Sample to add
-     * @param  timestamp    Timestamp for sample
-     * @return index_t      Dirty count
+     * @return  Snapshot with `size()`, `[]` and iteration like the series
      */
-    constexpr auto add(const T_value& val, const T_time& timestamp) noexcept {
-        dirty += _add(val, timestamp, 0);
-        return dirty;
+    auto snapshot() {
+        static_assert(snapshots_t::enabled, "snapshot() requires the sts::cow_snapshots policy");
+        return snapshots.take(values.data(), timestamps.data(), scores.data(), utilized, [this]() {
+            std::vector<index_t> seq;
+            seq.reserve(utilized);
+            auto c = order.seek(0, utilized);
+            for (index_t r = 0; r < utilized; ++r, c = order.next(c)) seq.push_back(order.slot(c));
+            return seq;
+        });
+    }
+
+    constexpr auto operator[](const index_t n) noexcept {
+        const auto o = slot_at(n);
+        return std::forward_as_tuple(values[o], timestamps[o], scores[o]);
     }
+    constexpr auto operator[](const index_t n) const noexcept {
+        const auto o = slot_at(n);
+        return std::forward_as_tuple(values[o], timestamps[o], scores[o]);
+    }
+
+    constexpr iterator begin() noexcept { return { *this, 0 }; }
+    constexpr iterator end()   noexcept { return { *this, utilized }; }
+    constexpr const_iterator begin()  const noexcept { return { *this, 0 }; }
+    constexpr const_iterator end()    const noexcept { return { *this, utilized }; }
+    constexpr const_iterator cbegin() const noexcept { return begin(); }
+    constexpr const_iterator cend()   const noexcept { return end(); }
+};
+
+/**
+ * @brief Many equally sized series, e.g. one per sensor, indexed by series
+ * ID. The series objects live in one array allocated at construction. With
+ * a fixed `S` the default columns and indices are part of the series
+ * object, so they take no further allocation. `sts::slab_values` and
+ * `sts::cow_snapshots` still allocate per series, on first use. The columns
+ * are not shared between series: each series is stored as a whole, one
+ * after the other.
+ * 
+ * @tparam T_value Value type
+ * @tparam S       Samples to store per series, fixed
+ * @tparam Reverse Iteration order of each series
+ * @tparam T_time  Timestamp type
+ * @tparam T_score Score type
+ * @tparam Policies Policy tags, as for `selective_time_series`. The
+ *                  allocator policy allocates the arena.
+ */
+template <typename T_value, std::size_t S, bool Reverse = false, typename T_time = std::size_t, typename T_score = float, typename... Policies>
+class selective_time_series_pool {
+    static_assert(S != sts::dynamic, "A pool needs a fixed series capacity");
+public:
+    /** @brief Type of each series. */
+    using series_type = selective_time_series<T_value, S, Reverse, T_time, T_score, Policies...>;
+    using allocator_type = typename series_type::allocator_type;
+
     /**
-     * @brief Add a scored sample to the dataset, dirty counter is not increased.
+     * @brief Construct `count` empty series, in one array.
      * 
-     * @param  val          Sample to add
-     * @param  timestamp    Timestamp for sample
-     * @param  score        Score for sample
-     * @return index_t      Dirty count
+     * @param  count    Amount of series
+     * @param  alloc    Allocator for the arena
      */
-    constexpr auto add(const T_value& val, const T_time& timestamp, const T_score& score) noexcept {
-        _add(val, timestamp, score);
-        return dirty;
+    explicit selective_time_series_pool(std::size_t count, const allocator_type& alloc = allocator_type())
+        : series(count, alloc) {}
+
+    /** @brief Amount of series. */
+    std::size_t size() const noexcept { return series.size(); }
+
+    series_type&       operator[](std::size_t id)       noexcept { return series[id]; }
+    const series_type& operator[](std::size_t id) const noexcept { return series[id]; }
+
+    series_type*       begin()       noexcept { return series.begin(); }
+    const series_type* begin() const noexcept { return series.begin(); }
+    series_type*       end()       noexcept { return series.end(); }
+    const series_type* end() const noexcept { return series.end(); }
+
+    /** @brief Add a scored sample to series `id`. */
+    void add(std::size_t id, const T_value& val, const T_time& timestamp, const T_score& score) noexcept(noexcept(std::declval<series_type&>().add(val, timestamp, score))) {
+        series[id].add(val, timestamp, score);
     }
 
-    constexpr auto insertion_offset(const T_time& timestamp) const noexcept {
-        index_t i = 0;
-        if constexpr (Reverse) {
-            for (i = S - utilized; i < S; ++i) {
-                if (timestamp > timestamps[offsets[i]]) return i;
-            } // Data too old, insert at back
-        } else {
-            for (; i < utilized; ++i) {
-                if (timestamp < timestamps[offsets[i]]) return i;
-            } // Data too new, insert at back
+    /**
+     * @brief Add `n` scored samples, sample `i` to series `ids[i]`, with the
+     * same end result as calling `add(...)` for each in turn. The samples are
+     * grouped by series first (keeping their order within a series), so each
+     * series is visited once while its columns are in cache. Once a series
+     * is full its worst score can only improve, so the worst is looked up
+     * once per series and a sample scoring worse than it costs one compare.
+     *
+     * @param  ids      Series ID per sample
+     * @param  vals     Samples to add
+     * @param  times    Timestamps for the samples
+     * @param  scs      Scores for the samples
+     * @param  n        Amount of samples
+     */
+    void add(const std::size_t* ids, const T_value* vals, const T_time* times, const T_score* scs, const std::size_t n) {
+        std::vector<std::size_t> grouped(n);
+        std::iota(grouped.begin(), grouped.end(), std::size_t{0});
+        std::stable_sort(grouped.begin(), grouped.end(), [ids](std::size_t a, std::size_t b) { return ids[a] < ids[b]; });
+
+        for (std::size_t i = 0; i < n;) {
+            const std::size_t id = ids[grouped[i]];
+            auto& ts = series[id];
+            bool full = ts.size() == ts.capacity();
+            T_score threshold = full ? std::get<2>(ts.worst()) : T_score{};
+            for (; i < n && ids[grouped[i]] == id; ++i) {
+                const auto k = grouped[i];
+                // The last sample of a run always goes through add(...),
+                // which also sets the next default timestamp when rejecting
+                const bool last = i + 1 == n || ids[grouped[i + 1]] != id;
+                if (full && scs[k] > threshold && !last) continue;
+                ts.add(vals[k], times[k], scs[k]);
+                if (!full && ts.size() == ts.capacity()) {
+                    full = true;
+                    threshold = std::get<2>(ts.worst());
+                }
+            }
         }
-        return i;
     }
 
-    constexpr bool has(const std::tuple<const T_value&, const T_time&, const T_score&>&& elem) const noexcept {
-        return  std::find(timestamps.begin(), timestamps.end(), std::get<TIM>(elem)) != timestamps.end() &&
-                std::find(scores.begin(), scores.end(), std::get<SCO>(elem)) != scores.end() &&
-                std::find(values.begin(), values.end(), std::get<VAL>(elem)) != values.end();
+#if __cplusplus >= 202002L && __has_include(<span>)
+    /** @brief `add(...)` over equally sized spans. */
+    void add(std::span<const std::size_t> ids, std::span<const T_value> vals, std::span<const T_time> times, std::span<const T_score> scs) {
+        add(ids.data(), vals.data(), times.data(), scs.data(), std::min({ ids.size(), vals.size(), times.size(), scs.size() }));
+    }
+#endif
+
+private:
+    sts::detail::column<series_type, sts::dynamic, allocator_type> series;
+};
+
+/**
+ * @brief Selective series fed by many threads at once. Each producer thread
+ * is bound to one of several shards, each a full `selective_time_series`
+ * behind its own mutex. A shard publishes its worst score once full, so
+ * samples it would reject are dropped without taking the lock.
+ * 
+ * Every shard keeps up to the full capacity: a sample among the best S
+ * overall is always among the best S of its shard, so `snapshot()` combines
+ * the shards into exactly the best S. Memory is therefore that of
+ * `shards()` series of `S` samples, plus the same again while snapshotting.
+ * 
+ * Shards insert out of order and look up their worst after every stored
+ * sample, both under the lock. Unless `Policies` pick otherwise, they use
+ * `sts::worst_heap` and, above 64 samples, `sts::fenwick_order`: O(log S)
+ * for both instead of O(S).
+ * 
+ * Template parameters are those of `selective_time_series`.
+ */
+template <typename T_value, std::size_t S, bool Reverse = false, typename T_time = std::size_t, typename T_score = float, typename... Policies>
+class concurrent_selective_time_series {
+public:
+    /** @brief Type of each shard, and of a snapshot. Policies given first
+               win over the defaults appended here. */
+    using series_type = selective_time_series<T_value, S, Reverse, T_time, T_score, Policies..., sts::worst_heap,
+                                              std::conditional_t<(S <= 64), sts::small_order, sts::fenwick_order>>;
+
+    concurrent_selective_time_series() : concurrent_selective_time_series(S) {
+        static_assert(S != sts::dynamic, "Pass the capacity of a dynamic series to the constructor");
+    }
+
+    /**
+     * @brief Construct with `shards` shards, one per hardware thread if 0.
+     * 
+     * @param  capacity     Samples to store, must equal `S` unless dynamic
+     * @param  shards       Amount of shards
+     */
+    explicit concurrent_selective_time_series(std::size_t capacity, std::size_t shards = 0)
+        : cap{capacity}, count{shards ? shards : std::max(1u, std::thread::hardware_concurrency())} {
+        for (std::size_t i = 0; i < count; ++i) parts.push_back(std::make_unique<shard>(cap));
     }
 
+    /** @brief Maximum amount of samples stored. */
+    std::size_t capacity() const noexcept { return cap; }
+
+    /** @brief Amount of shards. */
+    std::size_t shards() const noexcept { return count; }
+
     /**
-     * @brief Like `add(...)`, but instead of assuming the timestamp is always
-     * newest, inserts at the proper location. More expensive.
+     * @brief Add a scored sample from any thread. Samples may arrive out of
+     * timestamp order across threads, they are inserted at their proper
+     * location within the shard.
      * 
      * @param  val          Sample to add
      * @param  timestamp    Timestamp for sample
      * @param  score        Score for sample
      */
-    constexpr bool insert_one(const std::tuple<const T_value&, const T_time&, const T_score&>&& elem) noexcept {
-        if (std::get<TIM>(elem) + 1 > last_timestamp_plus_one) {
-            last_timestamp_plus_one = std::get<TIM>(elem) + 1;
+    void add(const T_value& val, const T_time& timestamp, const T_score& score) {
+        shard& s = *parts[thread_ticket() % count];
+        if (score > s.worst.load(std::memory_order_relaxed)) return;
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.series.insert(val, timestamp, score);
+        if (s.series.size() == cap) s.worst.store(std::get<2>(s.series.worst()), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Exact best `capacity()` samples over all shards, as a regular
+     * series in chronological order. Shards are locked one at a time, so
+     * samples added meanwhile may or may not be included. The series is
+     * heap allocated, a fixed `S` one may be too large for the stack.
+     */
+    std::unique_ptr<series_type> snapshot() const {
+        std::vector<std::tuple<T_value, T_time, T_score>> samples;
+        for (std::size_t i = 0; i < count; ++i) {
+            std::lock_guard<std::mutex> lock(parts[i]->mutex);
+            for (const auto& [v, t, sc] : parts[i]->series) samples.emplace_back(v, t, sc);
         }
+        auto res = std::make_unique<series_type>(cap);
+        res->insert_range(samples.begin(), samples.end());
+        return res;
+    }
 
-        if (utilized < S) {
-            values[utilized] = std::get<VAL>(elem);
-            timestamps[utilized] = std::get<TIM>(elem);
-            scores[utilized] = std::get<SCO>(elem);
+private:
+    struct alignas(64) shard {
+        explicit shard(std::size_t capacity) : series(capacity) {}
 
-            const auto io = insertion_offset(std::get<TIM>(elem));
-            
-            if constexpr (Reverse) {
-                auto b = offsets.begin() + S - utilized;
-                std::move(b, b + io, b - 1);
-            } else {
-                std::move(offsets.begin() + io, offsets.begin() + utilized, offsets.begin() + io + 1);
-            }
-            ++utilized;
-            return true;
+        mutable std::mutex mutex;
+        series_type series;
+        // Only improves once the shard is full, so a stale value is safe
+        // to reject against
+        std::atomic<T_score> worst { std::numeric_limits<T_score>::max() };
+    };
 
-        } else {
-            const auto [wi, ws] = worst_index();
+    /** @brief Per-thread number, handing out shards round robin. */
+    static std::size_t thread_ticket() noexcept {
+        static std::atomic<std::size_t> next {0};
+        thread_local const std::size_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+        return ticket;
+    }
 
-            if (std::get<SCO>(elem) > ws) {
-                return false;
-            }
+    std::size_t cap;
+    std::size_t count;
+    std::vector<std::unique_ptr<shard>> parts;
+};
 
-            values[wi] = std::get<VAL>(elem);
-            timestamps[wi] = std::get<TIM>(elem);
-            scores[wi] = std::get<SCO>(elem);
+/**
+ * @brief Wait-free single producer, single consumer queue in front of a
+ * series. One thread `push(...)`es samples without ever blocking on the
+ * series, another `drain()`s them in batches through `add_batch(...)`, whose
+ * threshold pass rejects most samples before they touch the series.
+ * 
+ * @tparam Series   Series type, e.g. `selective_time_series<float, 1000>`
+ */
+template <typename Series>
+class ingest_ring {
+    using T_value = typename Series::value_type;
+    using T_time  = typename Series::time_type;
+    using T_score = typename Series::score_type;
 
-            const auto wo = find_offset_index(wi);
-            const auto io = insertion_offset(std::get<TIM>(elem));
+    template <typename T>
+    using column = sts::detail::column<T, sts::dynamic, std::allocator<T>>;
+public:
+    /**
+     * @brief Queue for `target`, holding up to `capacity` samples, rounded
+     * up to a power of two.
+     * 
+     * @param  target       Series drained into, must outlive the ring
+     * @param  capacity     Queue size
+     */
+    explicit ingest_ring(Series& target, std::size_t capacity = 4096)
+        : series{target}, mask{sts::detail::ceil_pow2(std::max<std::size_t>(capacity, 2)) - 1},
+          values(mask + 1, {}), timestamps(mask + 1, {}), scores(mask + 1, {}) {}
 
-            if (io < wo) {
-                std::move(offsets.begin() + io, offsets.begin() + wo, offsets.begin() + io + 1);
-                offsets[io] = wi;
-            } else if (wo < io) {
+    /** @brief Samples the queue holds at most. */
+    std::size_t capacity() const noexcept { return mask + 1; }
 
-                std::move(offsets.begin() + wo + 1, offsets.begin() + io, offsets.begin() + wo);
-                offsets[io-1] = wi;
+    /**
+     * @brief Queue a sample, producer thread only. Never blocks: if the queue
+     * is full the sample is dropped and counted.
+     * 
+     * @param  val          Sample to add
+     * @param  timestamp    Timestamp for sample
+     * @param  score        Score for sample
+     * @return bool         Queued
+     */
+    bool push(const T_value& val, const T_time& timestamp, const T_score& score) noexcept(std::is_nothrow_copy_assignable_v<T_value>) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head_cache > mask) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t - head_cache > mask) {
+                drops.store(drops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
             }
-            return true;
         }
+        values[t & mask] = val;
+        timestamps[t & mask] = timestamp;
+        scores[t & mask] = score;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
     }
 
-    template <std::size_t N, typename T, typename... Ts>
-    struct n_th_type {
-        using type = std::conditional_t<(N == 0), T, typename n_th_type<N-1, Ts...>::type>;
-    };
+    /**
+     * @brief Move up to `max` queued samples into the series, consumer
+     * thread only.
+     * 
+     * @param  max          Samples to take at most
+     * @return std::size_t  Samples taken
+     */
+    std::size_t drain(std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        const std::size_t n = std::min(max, tail.load(std::memory_order_acquire) - h);
+        // At most two contiguous runs, before and after the wrap
+        for (std::size_t done = 0; done < n;) {
+            const std::size_t i = (h + done) & mask;
+            const std::size_t run = std::min(n - done, mask + 1 - i);
+            series.add_batch(values.data() + i, timestamps.data() + i, scores.data() + i, run);
+            done += run;
+        }
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
 
-    template <typename... Ts>
-    constexpr void insert_multiple(const Ts& ...sample) {
-        //TODO: merge the 'worst' search operations
-        (insert_one(sample), ...);
+    /** @brief Samples currently queued, approximate while in use. */
+    std::size_t depth() const noexcept {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
     }
 
-    constexpr decltype(auto) insert(const T_value& val, const T_time& timestamp, const T_score& score) {
-        return insert_one(std::forward_as_tuple(val, timestamp, score));
+    /** @brief Samples dropped by `push(...)` because the queue was full. */
+    std::size_t dropped() const noexcept { return drops.load(std::memory_order_relaxed); }
+
+private:
+    Series& series;
+    const std::size_t mask;
+    column<T_value> values;
+    column<T_time>  timestamps;
+    column<T_score> scores;
+
+    // Producer and consumer state on separate cache lines
+    alignas(64) std::atomic<std::size_t> tail {0};
+    std::size_t head_cache {0};
+    std::atomic<std::size_t> drops {0};
+    alignas(64) std::atomic<std::size_t> head {0};
+};
+
+/**
+ * @brief Series with one writer thread and any number of reader threads
+ * that never block it. Every write bumps a version counter to odd before and
+ * to even after the change (a seqlock). Readers copy what they need and
+ * retry if the version was odd or changed meanwhile, so they always return
+ * a consistent copy, at a cost proportional to what they copy.
+ * 
+ * Readers never touch the series itself. The writer keeps a copy of the
+ * samples and of their order for them, and writes that copy only through
+ * relaxed atomic stores, which readers match with relaxed atomic loads: no
+ * data race, at the price of storing every sample twice. Each write only
+ * updates the slots it changed, except `write(...)` and `add_batch(...)`,
+ * which update the whole copy in O(S).
+ * 
+ * @tparam Series   Series type, e.g. `selective_time_series<float, 1000>`
+ */
+template <typename Series>
+class seqlock_series {
+    using T_value = typename Series::value_type;
+    using T_time  = typename Series::time_type;
+    using T_score = typename Series::score_type;
+    using index_t = typename Series::index_t;
+    // Readers copy while the writer changes them, then throw torn copies away
+    static_assert(std::is_trivially_copyable_v<T_value> && std::is_trivially_copyable_v<T_time> && std::is_trivially_copyable_v<T_score>,
+                  "seqlock_series needs trivially copyable values, timestamps and scores");
+    template <typename T>
+    using column = sts::detail::column<T, sts::dynamic, std::allocator<T>>;
+public:
+    /** @brief A copied `(value, timestamp, score)`. */
+    using sample = std::tuple<T_value, T_time, T_score>;
+
+    /** @brief Construct the series from `args`. */
+    template <typename... Args>
+    explicit seqlock_series(Args&&... args)
+        : ts(std::forward<Args>(args)...),
+          values(ts.capacity(), {}), timestamps(ts.capacity(), {}), scores(ts.capacity(), {}),
+          prevs(ts.capacity(), {}), nexts(ts.capacity(), {}) {
+        publish_all();
     }
 
-    template <typename T, typename U, typename V, std::size_t N, bool B>
-    constexpr void merge(selective_time_series<T,N,B,U,V>& other) noexcept {
-        //TODO: merge the 'worst' search operations
-        for (const auto& e : other) {
-            if (!has(e)) {
-                insert_one(e);
-            }
-        }
+    /**
+     * @brief Run `f(series)` as one write, writer thread only. Use for any
+     * change not covered by the shorthands below.
+     */
+    template <typename F>
+    decltype(auto) write(F&& f) {
+        return publishing([&]() -> decltype(auto) { return f(ts); }, [this] { publish_all(); });
     }
 
-    /** @brief shorthand for `add(const T_value& val)` */
-    constexpr auto& operator+=(const T_value& val) noexcept { add(val); return this; }
+    /** @brief `add(...)` on the series, as one write. */
+    template <typename... Args>
+    auto add(Args&&... args) {
+        // A stored sample is the newest, in the slot it took
+        return publishing([&] { return ts.add(std::forward<Args>(args)...); }, [this] { publish_newest(); });
+    }
 
-    constexpr auto worst() noexcept {
-        const auto [ wi, ws ] = worst_index();
-        return std::forward_as_tuple(values[wi], timestamps[wi], scores[wi]);
+    /** @brief `insert(...)` on the series, as one write. */
+    template <typename... Args>
+    auto insert(Args&&... args) {
+        // The slot a stored sample takes: the next free one, or the worst
+        const index_t u = ts.utilized;
+        const index_t slot = u < ts.capacity() || u == 0 ? u : std::get<0>(ts.worst_index());
+        return publishing([&] { return ts.insert(std::forward<Args>(args)...); }, [this, slot] {
+            if (slot < ts.utilized) publish_slot(slot);
+        });
+    }
+
+    /** @brief `add_batch(...)` on the series, as one write. */
+    template <typename... Args>
+    auto add_batch(Args&&... args) {
+        return publishing([&] { return ts.add_batch(std::forward<Args>(args)...); }, [this] { publish_all(); });
     }
 
+    /** @brief The series itself, for reading on the writer thread. */
+    const Series& series() const noexcept { return ts; }
+
     /**
-     * @brief Return the, at most, min(N,S) best scoring elements pointers.
+     * @brief Copy the newest `n` samples (all if fewer are stored) into
+     * `out`, in iteration order, from any thread. O(n).
      * 
-     * @tparam N                        Result size
-     * @return std::array<element*, N>  Array of element pointers
+     * @param  n        Samples to copy at most
+     * @param  out      Replaced by the copies
      */
-    template <index_t N, typename... Ts>
-    constexpr std::array<std::tuple<T_value&, T_time&, T_score&>, N> best(Ts ...tups) noexcept {
-        static_assert(N <= S, "Can't select more 'best' elements than S");
-        if constexpr (sizeof...(Ts) < N) {
-            return best<N, Ts..., std::tuple<T_value&, T_time&, T_score&>>(tups..., std::forward_as_tuple(values[sizeof...(Ts)], timestamps[sizeof...(Ts)], scores[sizeof...(Ts)]));
-        } else {
-            std::array<std::tuple<T_value&, T_time&, T_score&>, N> res { tups... };
-
-            index_t wi = 0;
-            T_score ws = std::get<SCO>(res[0]);
-
-            for (index_t i = 1; i < N; ++i) {
-                if (ws < std::get<SCO>(res[i])) {
-                    wi = i;
-                    ws = std::get<SCO>(res[i]);
-                }
+    void newest(std::size_t n, std::vector<sample>& out) const {
+        for (;;) {
+            const auto v = begin_read();
+            out.clear();
+            const index_t size = load(count);
+            const auto k = static_cast<index_t>(std::min<std::size_t>(n, size));
+            bool valid = size <= ts.capacity();
+            index_t slot = load(tail);
+            for (index_t i = 0; valid && i < k; ++i) {
+                // Only follow a link that passed the bounds check
+                valid = slot < size;
+                if (!valid) break;
+                out.emplace_back(load(values[slot]), load(timestamps[slot]), load(scores[slot]));
+                if (i + 1 < k) slot = load(prevs[slot]);
             }
-            for (index_t i = N; i < utilized; ++i) {
-                if (ws > scores[i]) {
-                    res[wi] = { values[i], timestamps[i], scores[i] };
-                    for (index_t j = 0; j < N; ++j) {
-                        if (ws < std::get<SCO>(res[j])) {
-                            wi = j;
-                            ws = std::get<SCO>(res[j]);
-                        }
-                    }
-                }
+            if (valid && end_read(v)) break;
+        }
+        if constexpr (!Series::reverse) std::reverse(out.begin(), out.end());
+    }
+
+    /**
+     * @brief Copy the best `n` samples (all if fewer are stored) into `out`,
+     * in iteration order, from any thread. Copies all scores and the order,
+     * and selects from the copy: O(S).
+     * 
+     * @param  n        Samples to copy at most
+     * @param  out      Replaced by the copies
+     */
+    void best(std::size_t n, std::vector<sample>& out) const {
+        std::vector<T_score> scs;
+        std::vector<index_t> rank, slots;
+        for (;;) {
+            const auto v = begin_read();
+            out.clear();
+            const index_t size = load(count);
+            if (size > ts.capacity()) continue;
+            scs.resize(size);
+            rank.resize(size);
+            slots.resize(size);
+            // Walk the order from the newest, ranking each slot
+            index_t slot = load(tail);
+            bool valid = true;
+            for (index_t r = size; valid && r-- > 0;) {
+                valid = slot < size;
+                if (!valid) break;
+                scs[slot] = load(scores[slot]);
+                rank[slot] = r;
+                slots[r] = slot;
+                if (r) slot = load(prevs[slot]);
             }
-            // Looks like the STL has an issue sorting tuples of references.
-            // Need to follow-up.
-            // if constexpr (Reverse) {
-            //     std::sort(res.begin(), res.end(), [](const auto& a, const auto& b) { return std::get<TIM>(a) - std::get<TIM>(b); });
-            // } else {
-                // std::sort(res.begin(), res.end(), [](const auto& a, const auto& b) { return std::get<TIM>(b) < std::get<TIM>(a); });
-            // }
-            for (index_t i = 0; i < N; ++i) {
-                if constexpr (Reverse) {
-                    for (index_t j = i; j > 0 && (std::get<TIM>(res[j - 1]) < std::get<TIM>(res[j])); --j) {
-                        res[j].swap(res[j-1]);
-                    }
-                } else {
-                    for (index_t j = i; j > 0 && (std::get<TIM>(res[j - 1]) > std::get<TIM>(res[j])); --j) {
-                        res[j].swap(res[j-1]);
-                    }
-                }
+            if (!valid) continue;
+            // Select and sort on the copies, which are private even if torn
+            const auto k = static_cast<index_t>(std::min<std::size_t>(n, size));
+            std::nth_element(slots.begin(), slots.begin() + k, slots.end(), [&](index_t a, index_t b) {
+                return sts::detail::worse(scs.data(), b, a);
+            });
+            slots.resize(k);
+            std::sort(slots.begin(), slots.end(), [&](index_t a, index_t b) {
+                return Series::reverse ? rank[b] < rank[a] : rank[a] < rank[b];
+            });
+            for (const auto o : slots) out.emplace_back(load(values[o]), load(timestamps[o]), scs[o]);
+            if (end_read(v)) return;
+        }
+    }
+
+    /** @brief Amount of samples stored, from any thread. */
+    std::size_t size() const noexcept {
+        for (;;) {
+            const auto v = begin_read();
+            const std::size_t n = load(count);
+            if (end_read(v)) return n;
+        }
+    }
+
+private:
+    /** @brief Run `change()` and then `publish()` as one write. */
+    template <typename Change, typename Publish>
+    decltype(auto) publishing(Change&& change, Publish&& publish) {
+        const auto v = version.load(std::memory_order_relaxed);
+        version.store(v + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        struct done {
+            seqlock_series& self;
+            Publish& publish;
+            uint64_t v;
+            // Also after a throwing change, which may have changed the series
+            ~done() {
+                publish();
+                self.version.store(v + 2, std::memory_order_release);
             }
-            return res;
+        } guard { *this, publish, v };
+        return change();
+    }
+
+    /** @brief Wait for an even version and return it. */
+    uint64_t begin_read() const noexcept {
+        for (;;) {
+            const auto v = version.load(std::memory_order_acquire);
+            if (!(v & 1)) return v;
+            std::this_thread::yield();
         }
     }
 
-    constexpr auto operator[](const index_t n) noexcept {
-        if constexpr (Reverse) {
-            const auto o = offsets[S - utilized + n];
-            return std::forward_as_tuple(values[o], timestamps[o], scores[o]);
-        } else {
-            const auto o = offsets[n];
-            return std::forward_as_tuple(values[o], timestamps[o], scores[o]);
+    /** @brief Whether no write started since `begin_read()` returned `v`. */
+    bool end_read(uint64_t v) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version.load(std::memory_order_relaxed) == v;
+    }
+
+    template <typename T>
+    static T load(const T& x) noexcept { return sts::detail::relaxed<T>::load(x); }
+    template <typename T>
+    static void store(T& x, const T& v) noexcept { sts::detail::relaxed<T>::store(x, v); }
+
+    /** @brief Copy the sample in `slot` for the readers. */
+    void put(index_t slot) noexcept {
+        store(values[slot], ts.values[slot]);
+        store(timestamps[slot], ts.timestamps[slot]);
+        store(scores[slot], ts.scores[slot]);
+    }
+
+    /** @brief Take `slot` out of the readers' order. */
+    void unlink(index_t slot) noexcept {
+        const index_t p = prevs[slot], q = nexts[slot];
+        if (slot == head) head = q; else nexts[p] = q;
+        if (slot == tail) store(tail, p); else store(prevs[q], p);
+        --linked;
+    }
+
+    /** @brief Put `slot` first in the readers' order. */
+    void link_front(index_t slot) noexcept {
+        nexts[slot] = head;
+        if (linked) store(prevs[head], slot); else store(tail, slot);
+        head = slot;
+        ++linked;
+    }
+
+    /** @brief Put `slot` right after `p` in the readers' order. */
+    void link_after(index_t p, index_t slot) noexcept {
+        const index_t q = nexts[p];
+        nexts[slot] = q;
+        store(prevs[slot], p);
+        if (p == tail) store(tail, slot); else store(prevs[q], slot);
+        nexts[p] = slot;
+        ++linked;
+    }
+
+    /** @brief Publish the newest sample, after `add(...)`. O(1), O(log S)
+               for `sts::fenwick_order`. */
+    void publish_newest() noexcept {
+        const index_t n = ts.utilized;
+        if (n == 0) return;
+        const index_t slot = ts.order.at(n - 1, n);
+        if (!(linked && slot == tail)) {
+            if (slot < linked) unlink(slot);
+            if (linked) link_after(tail, slot); else link_front(slot);
         }
+        put(slot);
+        store(count, n);
     }
 
-    constexpr iterator begin() noexcept {
-        return { *this, Reverse ? static_cast<index_t>(S - utilized) : static_cast<index_t>(0) };
+    /** @brief Publish `slot` at its place, after `insert(...)`. Costs a rank
+               lookup, as `insert(...)` itself. */
+    void publish_slot(index_t slot) noexcept {
+        const index_t n = ts.utilized;
+        // The last sample not after its timestamp, unless equal ones follow
+        index_t r = ts.upper_rank(ts.timestamps[slot]);
+        auto c = ts.order.seek(r - 1, n);
+        while (r > 0 && ts.order.slot(c) != slot) {
+            if (--r) c = ts.order.prev(c);
+        }
+        if (r == 0) return publish_all(); // Samples out of timestamp order
+        if (slot < linked) unlink(slot);
+        if (r > 1) link_after(ts.order.slot(ts.order.prev(c)), slot); else link_front(slot);
+        put(slot);
+        store(count, n);
     }
-    constexpr iterator end() noexcept {
-        return { *this, Reverse ? static_cast<index_t>(S) : utilized };
+
+    /** @brief Publish every sample. O(S). */
+    void publish_all() noexcept {
+        const index_t n = ts.utilized;
+        linked = 0;
+        auto c = ts.order.seek(0, n);
+        for (index_t i = 0; i < n; ++i, c = ts.order.next(c)) {
+            const index_t slot = ts.order.slot(c);
+            if (i) link_after(tail, slot); else link_front(slot);
+            put(slot);
+        }
+        store(count, n);
     }
+
+    Series ts;
+    // The readers' copy: samples by slot, linked oldest to newest
+    column<T_value> values;
+    column<T_time>  timestamps;
+    column<T_score> scores;
+    column<index_t> prevs;
+    column<index_t> nexts; // Writer only
+    index_t head {0}, linked {0}; // Writer only
+    index_t tail {0}, count {0};
+    alignas(64) std::atomic<uint64_t> version {0};
 };
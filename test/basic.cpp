@@ -2,16 +2,16 @@
 
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <random>
 #include <cstddef>
 
-int main() {
+template <typename TS>
+void run(TS& ts) {
     std::default_random_engine e { 1u }; // Will result in the same 'random' generation each compile
     std::uniform_real_distribution<> rnd {0.0f, 1.0f};
     std::cout << std::setprecision(3) ;
 
-    selective_time_series<std::array<double, 8>, 100'000, false> ts;
-
     for (std::size_t i = 0; i < 200'000; ++i) {
         const auto score = rnd(e);
         ts.add({ rnd(e), rnd(e), rnd(e), rnd(e), rnd(e), rnd(e), rnd(e), rnd(e) }, i, score);
@@ -35,9 +35,18 @@ int main() {
 
     ts.insert({ rnd(e), rnd(e), rnd(e), rnd(e), rnd(e), rnd(e), rnd(e), rnd(e) }, 99, 0);
 
-    for (const auto& [v,t,s] : ts.best<11>()) {
+    for (const auto& [v,t,s] : ts.template best<11>()) {
         // if (n == nullptr) break; // Should only happen when N > .size()
         std::cout << s << " ";
     }
     std::cout << '\n';
-}
\ No newline at end of file
+}
+
+int main() {
+    // Too large for the stack
+    auto ts = std::make_unique<selective_time_series<std::array<double, 8>, 100'000, false>>();
+    run(*ts);
+
+    selective_time_series<std::array<double, 8>, sts::dynamic, false> dyn(100'000);
+    run(dyn);
+}
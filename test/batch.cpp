@@ -0,0 +1,572 @@
+#include "../selective_time_series.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <iterator>
+#if __cplusplus >= 202002L && __has_include(<ranges>)
+#include <ranges>
+#endif
+#include <random>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// Bulk operations must leave the series exactly as the equivalent sequence
+// of single-sample calls would.
+template <bool Reverse, typename... Ps>
+int check_add_batch(const char* name) {
+    constexpr std::size_t S = 100;
+
+    auto e = seeded();
+    std::uniform_real_distribution<float> rnd {0.0f, 1.0f};
+
+    selective_time_series<int, S, Reverse, std::size_t, float, Ps...> one, batch;
+
+    std::vector<int> values;
+    std::vector<std::size_t> timestamps;
+    std::vector<float> scores;
+    for (std::size_t round = 0, t = 0; round < 20; ++round) {
+        values.clear();
+        timestamps.clear();
+        scores.clear();
+        for (std::size_t i = 0; i < round * 97; ++i, ++t) {
+            values.push_back(static_cast<int>(t));
+            timestamps.push_back(t);
+            scores.push_back(rnd(e));
+            one.add(values.back(), timestamps.back(), scores.back());
+        }
+        batch.add_batch(values.data(), timestamps.data(), scores.data(), values.size());
+
+        if (!same(one, batch)) {
+            std::cout << "add_batch " << name << (Reverse ? " (reverse)" : "") << ": mismatch in round " << round << '\n';
+            return 1;
+        }
+    }
+    std::cout << "add_batch " << name << (Reverse ? " (reverse)" : "") << ": ok\n";
+    return 0;
+}
+
+template <bool Reverse, typename... Ps>
+int check_insert_range(const char* name) {
+    constexpr std::size_t S = 100;
+
+    auto e = seeded();
+    std::uniform_real_distribution<float> rnd {0.0f, 1.0f};
+    std::uniform_int_distribution<std::size_t> late {0, 250};
+
+    selective_time_series<int, S, Reverse, std::size_t, float, Ps...> one, batch;
+
+    std::vector<std::tuple<int, std::size_t, float>> samples;
+    for (std::size_t round = 0, t = 1000; round < 50; ++round) {
+        samples.clear();
+        for (std::size_t i = 0; i < round % 13 * 5 + round % 2; ++i) {
+            const std::size_t timestamp = i % 3 ? t - late(e) : ++t;
+            samples.emplace_back(static_cast<int>(round * 1000 + i), timestamp, rnd(e));
+            one.insert(std::get<0>(samples.back()), std::get<1>(samples.back()), std::get<2>(samples.back()));
+        }
+        batch.insert_range(samples.begin(), samples.end());
+
+        if (!same(one, batch)) {
+            std::cout << "insert_range " << name << (Reverse ? " (reverse)" : "") << ": mismatch in round " << round << '\n';
+            return 1;
+        }
+    }
+    std::cout << "insert_range " << name << (Reverse ? " (reverse)" : "") << ": ok\n";
+    return 0;
+}
+
+template <typename TS>
+bool contains(TS& ts, int value, std::size_t timestamp, float score) {
+    for (const auto& [v, t, s] : ts) {
+        if (v == value && t == timestamp && s == score) return true;
+    }
+    return false;
+}
+
+template <bool Reverse, typename... Ps>
+int check_merge(const char* name) {
+    constexpr std::size_t S = 100;
+
+    auto e = seeded();
+    std::uniform_real_distribution<float> rnd {0.0f, 1.0f};
+    std::uniform_int_distribution<> pick {0, 2};
+
+    selective_time_series<int, S, Reverse, std::size_t, float, Ps...> one, merged;
+    selective_time_series<int, 2 * S, !Reverse> other;
+
+    for (std::size_t t = 0; t < 1'000; ++t) {
+        const int value = static_cast<int>(t);
+        const float score = rnd(e);
+        const int where = pick(e); // Mine, theirs or both
+        if (where != 1) {
+            one.add(value, t, score);
+            merged.add(value, t, score);
+        }
+        if (where != 0) other.add(value, t, score);
+    }
+    for (const auto& [v, t, s] : other) {
+        if (!contains(one, v, t, s)) one.insert(v, t, s);
+    }
+    merged.merge(other);
+
+    if (!same(one, merged)) {
+        std::cout << "merge " << name << (Reverse ? " (reverse)" : "") << ": mismatch\n";
+        return 1;
+    }
+    std::cout << "merge " << name << (Reverse ? " (reverse)" : "") << ": ok\n";
+    return 0;
+}
+
+template <bool Reverse, typename... Ps>
+int check_pool(const char* name) {
+    constexpr std::size_t S = 20;
+    constexpr std::size_t N = 50;
+
+    auto e = seeded();
+    std::uniform_real_distribution<float> rnd {0.0f, 1.0f};
+    std::uniform_int_distribution<std::size_t> sensor {0, N - 1};
+
+    std::vector<selective_time_series<int, S, Reverse, std::size_t, float, Ps...>> one(N);
+    selective_time_series_pool<int, S, Reverse, std::size_t, float, Ps...> pool(N);
+
+    std::vector<std::size_t> ids;
+    std::vector<int> values;
+    std::vector<std::size_t> timestamps;
+    std::vector<float> scores;
+    for (std::size_t round = 0, t = 0; round < 20; ++round) {
+        ids.clear();
+        values.clear();
+        timestamps.clear();
+        scores.clear();
+        for (std::size_t i = 0; i < round * 97; ++i, ++t) {
+            ids.push_back(sensor(e));
+            values.push_back(static_cast<int>(t));
+            timestamps.push_back(t);
+            scores.push_back(rnd(e));
+            one[ids.back()].add(values.back(), timestamps.back(), scores.back());
+        }
+        pool.add(ids.data(), values.data(), timestamps.data(), scores.data(), ids.size());
+
+        for (std::size_t id = 0; id < N; ++id) {
+            if (!same(one[id], pool[id]) || (one[id].size() >= 5 && one[id].template best<5>() != pool[id].template best<5>())) {
+                std::cout << "pool " << name << (Reverse ? " (reverse)" : "") << ": mismatch in round " << round << '\n';
+                return 1;
+            }
+        }
+        // Rejected samples still move the next default timestamp on
+        if (round % 4 == 3) {
+            for (std::size_t id = 0; id < N; ++id) {
+                one[id].add(-1);
+                pool[id].add(-1);
+            }
+        }
+    }
+    std::cout << "pool " << name << (Reverse ? " (reverse)" : "") << ": ok\n";
+    return 0;
+}
+
+// best(n, out) and best<N>() must return the n lowest scores, in iteration
+// order, and nothing but stored samples.
+template <bool Reverse, typename... Ps>
+int check_best(const char* name) {
+    constexpr std::size_t S = 100;
+
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 30};
+
+    selective_time_series<int, S, Reverse, std::size_t, float, Ps...> ts;
+    std::vector<std::tuple<int&, std::size_t&, float&>> out;
+    // An empty series has nothing to select, with sts::slab_values not even
+    // storage to refer to
+    bool ok = ts.best(3, std::back_inserter(out)) == 0 && out.empty();
+    for (std::size_t t = 0; t < 300 && ok; ++t) {
+        ts.add(static_cast<int>(t), t, static_cast<float>(rnd(e)));
+        for (const std::size_t n : { 0, 1, 3, 12, 13, 40, 100, 150 }) {
+            out.clear();
+            const auto k = ts.best(n, std::back_inserter(out));
+            ok = ok && k == std::min<std::size_t>(n, ts.size()) && out.size() == k;
+            // Nothing left out scores better than what was selected
+            std::vector<float> all, picked;
+            for (const auto& [v, tm, sc] : ts) all.push_back(sc);
+            for (const auto& [v, tm, sc] : out) picked.push_back(sc);
+            std::sort(all.begin(), all.end());
+            std::sort(picked.begin(), picked.end());
+            ok = ok && std::equal(picked.begin(), picked.end(), all.begin());
+            for (std::size_t i = 1; i < out.size(); ++i) {
+                ok = ok && (Reverse ? std::get<1>(out[i]) < std::get<1>(out[i - 1]) : std::get<1>(out[i - 1]) < std::get<1>(out[i]));
+            }
+        }
+        // The compile time variant selects the same samples, once there are
+        // enough of them
+        if (ts.size() >= 5) {
+            out.clear();
+            ts.best(5, std::back_inserter(out));
+            const auto fixed = ts.template best<5>();
+            for (std::size_t i = 0; i < out.size(); ++i) ok = ok && std::get<1>(fixed[i]) == std::get<1>(out[i]);
+        }
+    }
+    std::cout << "best " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// range(), lower_bound(), upper_bound() and nearest() must find what a walk
+// over all samples finds, duplicate timestamps included.
+template <bool Reverse, typename... Ps>
+int check_range(const char* name) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 30};
+
+    selective_time_series<int, 50, Reverse, std::size_t, float, Ps...> ts;
+    // Position of the first sample, in iteration order, passing `pred`
+    const auto first = [&](auto pred) {
+        std::size_t n = 0;
+        for (const auto& [v, t, s] : ts) {
+            if (pred(t)) break;
+            ++n;
+        }
+        return n;
+    };
+    const auto position = [&](auto it) {
+        std::size_t n = 0;
+        for (auto i = ts.begin(); i != it; ++i) ++n;
+        return n;
+    };
+    bool ok = true;
+    for (int i = 0; i < 400 && ok; ++i) {
+        ts.insert(i, static_cast<std::size_t>(2 * i - rnd(e) / 3 * 2), static_cast<float>(rnd(e)));
+        for (std::size_t t = 2 * i > 90 ? 2 * i - 90 : 0; t < std::size_t(2 * i + 3) && ok; ++t) {
+            const auto lb = first([&](std::size_t x) { return Reverse ? x <= t : x >= t; });
+            const auto ub = first([&](std::size_t x) { return Reverse ? x < t : x > t; });
+            ok = position(ts.lower_bound(t)) == lb && position(ts.upper_bound(t)) == ub;
+
+            std::vector<std::size_t> want, got;
+            for (const auto& [v, x, s] : ts) {
+                if (t <= x && x < t + 7) want.push_back(x);
+            }
+            const auto r = ts.range(t, t + 7);
+            for (const auto& [v, x, s] : r) got.push_back(x);
+            ok = ok && want == got && r.size() == got.size();
+
+            std::size_t best = ~std::size_t{0};
+            for (const auto& [v, x, s] : ts) best = std::min(best, x < t ? t - x : x - t);
+            const auto n = ts.nearest(t);
+            const auto x = std::get<1>(*n);
+            ok = ok && (x < t ? t - x : x - t) == best;
+        }
+    }
+    std::cout << "range " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Iterators must step, jump and compare like positions in `[]`, for const
+// series too, and work with the standard algorithms.
+template <bool Reverse, typename... Ps>
+int check_iterators(const char* name) {
+    using series = selective_time_series<int, 60, Reverse, std::size_t, float, Ps...>;
+#if __cplusplus >= 202002L && defined(__cpp_lib_ranges)
+    static_assert(std::ranges::bidirectional_range<series> && std::ranges::bidirectional_range<const series>);
+    static_assert(std::ranges::random_access_range<series> == std::is_same_v<typename series::iterator::iterator_concept, std::random_access_iterator_tag>);
+    static_assert(std::ranges::random_access_range<const series> == std::ranges::random_access_range<series>);
+#endif
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 30};
+
+    series ts;
+    bool ok = true;
+    for (int i = 0; i < 200 && ok; ++i) {
+        ts.add(i, static_cast<std::size_t>(i), static_cast<float>(rnd(e)));
+        const series& cts = ts;
+        const auto n = static_cast<std::ptrdiff_t>(ts.size());
+        ok = cts.end() - cts.begin() == n && std::distance(ts.begin(), ts.end()) == n;
+        typename series::const_iterator it = ts.begin();
+        for (std::ptrdiff_t j = 0; ok && j < n; ++j, ++it) {
+            const auto k = static_cast<std::size_t>(j);
+            ok = std::get<1>(*it) == std::get<1>(ts[k]) && std::get<1>(cts.begin()[j]) == std::get<1>(cts[k])
+                 && std::get<1>(*(ts.end() - (n - j))) == std::get<1>(ts[k]) && (ts.begin() + j < ts.end()) && it - cts.begin() == j;
+        }
+        // Walk back from the end
+        std::size_t k = ts.size();
+        for (auto b = ts.end(); ok && b != ts.begin();) ok = std::get<1>(*--b) == std::get<1>(ts[--k]);
+
+        // Iteration is in timestamp order, so the standard binary search works
+        const std::size_t t = static_cast<std::size_t>(rnd(e)) + (i > 30 ? i - 30 : 0);
+        const auto by_time = [](const auto& a, std::size_t x) { return Reverse ? std::get<1>(a) > x : std::get<1>(a) < x; };
+        ok = ok && std::lower_bound(cts.begin(), cts.end(), t, by_time) == ts.lower_bound(t);
+
+        // The value type holds copies, not references into the series
+        typename series::iterator::value_type first = *ts.begin();
+        std::get<0>(*ts.begin()) += 1'000;
+        ok = ok && std::get<0>(first) + 1'000 == std::get<0>(ts[0]);
+        std::get<0>(*ts.begin()) -= 1'000;
+
+        std::size_t sum = 0, want = 0;
+        for (const auto& [v, tm, sc] : cts) want += tm;
+        std::for_each(cts.begin(), cts.end(), [&](const auto& x) { sum += std::get<1>(x); });
+        ok = ok && sum == want;
+#if __cplusplus >= 202002L && defined(__cpp_lib_ranges)
+        ok = ok && std::ranges::count_if(cts, [](const auto& x) { return std::get<2>(x) < 10; }) == std::count_if(cts.begin(), cts.end(), [](const auto& x) { return std::get<2>(x) < 10; });
+        const auto by_score = [](const auto& a, const auto& b) { return std::get<2>(a) < std::get<2>(b); };
+        ok = ok && std::ranges::max_element(ts, by_score) == std::max_element(ts.begin(), ts.end(), by_score);
+#endif
+    }
+    std::cout << "iterators " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Values handed over as rvalues or constructor arguments must never be
+// copied, and rejected samples must not be touched at all.
+struct counted {
+    static inline int copies = 0, moves = 0, constructs = 0;
+    int v = 0;
+    counted() = default;
+    explicit counted(int x) noexcept : v{x} { ++constructs; }
+    counted(const counted& o) : v{o.v} { ++copies; }
+    counted(counted&& o) noexcept : v{o.v} { ++moves; }
+    counted& operator=(const counted& o) { v = o.v; ++copies; return *this; }
+    counted& operator=(counted&& o) noexcept { v = o.v; ++moves; return *this; }
+    bool operator==(const counted& o) const { return v == o.v; }
+};
+
+template <bool Reverse, typename... Ps>
+int check_moves(const char* name) {
+    selective_time_series<counted, 10, Reverse, std::size_t, float, Ps...> ts;
+    counted::copies = counted::moves = counted::constructs = 0;
+    bool ok = true;
+    for (int i = 0; i < 100; ++i) {
+        counted c { i };
+        const int moves = counted::moves;
+        switch (i % 4) {
+        case 0: ts.add(std::move(c), i, static_cast<float>(100 - i)); break;
+        case 1: ts.insert(std::move(c), i, static_cast<float>(100 - i)); break;
+        case 2: ts.insert_one(std::forward_as_tuple(std::move(c), std::size_t(i), float(100 - i))); break;
+        default: ts.emplace(i, static_cast<float>(100 - i), i); --counted::constructs; break;
+        }
+        ok = ok && counted::moves <= moves + 1;
+    }
+    ts.emplace_insert(50, 0.0f, 1'000);
+    ok = ok && counted::copies == 0 && counted::constructs == 101 && std::get<0>(ts.template best<1>()[0]).v == 1'000;
+
+    // Rejected: worse than everything stored
+    counted rejected { -1 };
+    const int moves = counted::moves, constructs = counted::constructs;
+    ts.add(std::move(rejected), 200, 1'000.0f);
+    ts.insert(std::move(rejected), 10, 1'000.0f);
+    ts.emplace(201, 1'000.0f, -1);
+    ts.emplace_insert(11, 1'000.0f, -1);
+    ok = ok && counted::moves == moves && counted::constructs == constructs && counted::copies == 0;
+
+    std::cout << "moves " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// A value whose construction throws must leave the series as it was, and
+// only the entry points that cannot throw are noexcept.
+struct fragile {
+    int v = 0;
+    fragile() = default;
+    explicit fragile(int x) : v{x} { if (x < 0) throw x; }
+    bool operator==(const fragile& o) const { return v == o.v; }
+};
+
+template <bool Reverse, typename... Ps>
+int check_throwing(const char* name) {
+    using series = selective_time_series<fragile, 10, Reverse, std::size_t, float, Ps...>;
+    series ts;
+    static_assert(!noexcept(ts.emplace(0, 0.0f, 1)) && !noexcept(ts.emplace_insert(0, 0.0f, 1)));
+    static_assert(noexcept(ts.add(fragile{}, 0, 0.0f)) && noexcept(ts.add(std::declval<const fragile&>(), 0, 0.0f)));
+    static_assert(noexcept(std::declval<selective_time_series<counted, 10>&>().emplace(0, 0.0f, 1)));
+
+    bool ok = true;
+    for (int i = 0; i < 40; ++i) {
+        ts.emplace(static_cast<std::size_t>(i), static_cast<float>(i % 7), i);
+        std::vector<std::tuple<int, std::size_t, float>> before, after;
+        for (const auto& [v, t, s] : ts) before.emplace_back(v.v, t, s);
+        int thrown = 0;
+        try {
+            i % 2 ? ts.emplace(1'000, 0.0f, -1) : ts.emplace_insert(static_cast<std::size_t>(i / 2), 0.0f, -1);
+        } catch (int) {
+            ++thrown;
+        }
+        for (const auto& [v, t, s] : ts) after.emplace_back(v.v, t, s);
+        ok = ok && thrown == 1 && before == after && ts.has({ std::get<0>(ts[0]), std::get<1>(ts[0]), std::get<2>(ts[0]) });
+    }
+    std::cout << "throwing " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Copying or moving a negative one throws. The move leaves 0 behind, so a
+// value the sink took shows.
+struct brittle {
+    int v = 0;
+    brittle() = default;
+    explicit brittle(int x) : v{x} {}
+    brittle(const brittle& o) : v{o.v} { if (v < 0) throw v; }
+    brittle(brittle&& o) : v{std::exchange(o.v, 0)} { if (v < 0) throw v; }
+    brittle& operator=(const brittle& o) { if (o.v < 0) throw o.v; v = o.v; return *this; }
+    brittle& operator=(brittle&& o) { if (o.v < 0) throw o.v; v = std::exchange(o.v, 0); return *this; }
+    bool operator==(const brittle& o) const { return v == o.v; }
+};
+
+struct take {
+    std::vector<int>* taken = nullptr;
+    void operator()(brittle& v, std::size_t, float) noexcept { taken->push_back(std::exchange(v.v, 0)); }
+};
+
+// With an eviction sink that moves values out, a value that fails to copy or
+// move into the series must neither reach the sink nor empty the sample it
+// would have replaced.
+template <bool Reverse, typename... Ps>
+int check_throwing_sink(const char* name) {
+    selective_time_series<brittle, 10, Reverse, std::size_t, float, sts::eviction_sink<take>, Ps...> ts;
+    std::vector<int> taken;
+    ts.eviction_sink().taken = &taken;
+    for (int i = 1; i <= 10; ++i) ts.add(brittle{i}, static_cast<std::size_t>(10 * i), static_cast<float>(i));
+
+    bool ok = true;
+    for (int i = 0; i < 40 && ok; ++i) {
+        std::vector<std::tuple<int, std::size_t, float>> before, after;
+        for (const auto& [v, t, s] : ts) before.emplace_back(v.v, t, s);
+        brittle bad { -1 };
+        const auto t = static_cast<std::size_t>(i % 2 ? 1'000 + i : 10 * (i / 4) + 5);
+        int thrown = 0;
+        try {
+            switch (i % 4) {
+            case 0:  ts.insert(std::move(bad), t, -1'000.0f); break;
+            case 1:  ts.add(std::move(bad), t, -1'000.0f); break;
+            case 2:  ts.insert(bad, t, -1'000.0f); break;
+            default: ts.add(bad, t, -1'000.0f); break;
+            }
+        } catch (int) {
+            ++thrown;
+        }
+        for (const auto& [v, tm, s] : ts) after.emplace_back(v.v, tm, s);
+        ok = thrown == 1 && before == after && taken.size() == static_cast<std::size_t>(i);
+
+        // A value that does move in passes the one it replaces to the sink
+        const int worst = std::get<0>(ts.worst()).v;
+        ts.add(brittle{100 + i}, 2'000 + static_cast<std::size_t>(i), static_cast<float>(-i));
+        ok = ok && !taken.empty() && taken.back() == worst;
+    }
+    std::cout << "throwing_sink " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Copies throw once the budget runs out, moves never do.
+struct limited {
+    static inline int copies_left = -1; // No limit
+    int v = 0;
+    limited() = default;
+    explicit limited(int x) : v{x} {}
+    limited(const limited& o) : v{o.v} { spend(); }
+    limited(limited&&) noexcept = default;
+    limited& operator=(const limited& o) { spend(); v = o.v; return *this; }
+    limited& operator=(limited&&) noexcept = default;
+    bool operator==(const limited& o) const { return v == o.v; }
+    static void spend() {
+        if (copies_left == 0) throw 0;
+        if (copies_left > 0) --copies_left;
+    }
+};
+
+// Iterates in timestamp order and agrees with the score index on the worst.
+template <typename TS>
+bool consistent(TS& ts) {
+    std::size_t n = 0, previous = 0;
+    float worst = 0.0f;
+    bool ordered = true;
+    for (const auto& [v, t, s] : ts) {
+        ordered = ordered && (n == 0 || (TS::reverse ? t <= previous : previous <= t));
+        worst = n++ ? std::max(worst, s) : s;
+        previous = t;
+    }
+    return ordered && n == ts.size() && (n == 0 || std::get<2>(ts.worst()) == worst);
+}
+
+// A batch whose sixth copy throws, or holding a value that throws on copy
+// and move, must leave the series as it was (values that may also throw on
+// moving go in one by one, so only those before the throw are added) and
+// consistent enough to keep adding to.
+template <bool Reverse, typename V, typename... Ps>
+int check_throwing_batch(const char* name) {
+    using series = selective_time_series<V, 50, Reverse, std::size_t, float, Ps...>;
+    constexpr bool strong = std::is_nothrow_move_assignable_v<V>;
+    bool ok = true;
+    for (const bool merge : { false, true }) {
+        series ts, other;
+        for (int i = 0; i < 40; ++i) ts.emplace(static_cast<std::size_t>(10 * i), static_cast<float>(i % 9), i);
+        // Filled in place, a brittle -1 cannot even be moved into the batch
+        std::vector<std::tuple<V, std::size_t, float>> batch(20);
+        for (int i = 0; i < 20; ++i) {
+            const int v = i == 5 ? -1 : 200 + i;
+            batch[i] = { V{}, static_cast<std::size_t>(20 * i + 3), static_cast<float>(i % 4) };
+            std::get<0>(batch[i]).v = v;
+            other.emplace(static_cast<std::size_t>(20 * i + 3), static_cast<float>(i % 4), 200 + i);
+        }
+        for (auto&& [v, t, s] : other) {
+            if (t == 5 * 20 + 3) v.v = -1;
+        }
+        std::vector<std::tuple<int, std::size_t, float>> before, after;
+        for (const auto& [v, t, s] : ts) before.emplace_back(v.v, t, s);
+        int thrown = 0;
+        limited::copies_left = 5;
+        try {
+            merge ? ts.merge(other) : ts.insert_range(batch.begin(), batch.end());
+        } catch (int) {
+            ++thrown;
+        }
+        limited::copies_left = -1;
+        for (const auto& [v, t, s] : ts) after.emplace_back(v.v, t, s);
+        ok = ok && thrown == 1 && (!strong || before == after) && consistent(ts);
+        for (int i = 0; i < 200 && ok; ++i) {
+            ts.emplace(static_cast<std::size_t>(1'000 + i), static_cast<float>(i % 11), 1'000 + i);
+            ok = consistent(ts);
+        }
+    }
+    std::cout << "throwing_batch " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+int main() {
+    int failed = 0;
+    failed += check_add_batch<false>("default");
+    failed += check_add_batch<true>("default");
+    failed += check_add_batch<false, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_add_batch<true,  sts::worst_heap, sts::fenwick_order>("worst_heap + fenwick_order");
+    failed += check_insert_range<false>("default");
+    failed += check_insert_range<true>("default");
+    failed += check_insert_range<false, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_insert_range<true,  sts::worst_heap, sts::fenwick_order>("worst_heap + fenwick_order");
+    failed += check_merge<false>("default");
+    failed += check_merge<true>("default");
+    failed += check_merge<false, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_merge<true,  sts::worst_heap, sts::fenwick_order>("worst_heap + fenwick_order");
+    failed += check_pool<false>("default");
+    failed += check_pool<true, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_best<false>("default");
+    failed += check_best<true, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_best<false, sts::minmax_heap>("minmax_heap");
+    failed += check_best<true, sts::slab_values, sts::top_k<4>>("slab_values + top_k");
+    failed += check_range<false>("default");
+    failed += check_range<true>("default");
+    failed += check_range<false, sts::linked_order>("linked_order");
+    failed += check_range<true,  sts::fenwick_order>("fenwick_order");
+    failed += check_range<true,  sts::dense_order>("dense_order");
+    failed += check_iterators<false>("default");
+    failed += check_iterators<true,  sts::dense_order>("dense_order");
+    failed += check_iterators<false, sts::fenwick_order>("fenwick_order");
+    failed += check_iterators<true,  sts::linked_order>("linked_order");
+    failed += check_moves<false>("default");
+    failed += check_moves<true, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_throwing<false>("default");
+    failed += check_throwing<true, sts::worst_heap, sts::timestamp_hash, sts::slab_values>("worst_heap + timestamp_hash + slab_values");
+    failed += check_throwing_sink<false>("default");
+    failed += check_throwing_sink<true, sts::worst_heap, sts::fenwick_order, sts::slab_values>("worst_heap + fenwick_order + slab_values");
+    failed += check_throwing_batch<false, limited, sts::worst_heap>("worst_heap");
+    failed += check_throwing_batch<true,  limited>("default");
+    failed += check_throwing_batch<false, limited, sts::minmax_heap, sts::fenwick_order, sts::slab_values>("minmax_heap + fenwick_order + slab_values");
+    failed += check_throwing_batch<false, brittle, sts::worst_heap>("worst_heap, throwing moves");
+    failed += check_throwing_batch<true,  brittle, sts::worst_heap, sts::linked_order>("worst_heap + linked_order, throwing moves");
+    return failed;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <random>
+
+/** @brief Engine with a fixed seed. Will result in the same 'random'
+           generation each compile. */
+inline std::default_random_engine seeded() {
+    return std::default_random_engine { 1u };
+}
+
+/** @brief Whether both series hold the same samples, in the same order. */
+template <typename A, typename B>
+bool same(A& a, B& b) {
+    if (a.size() != b.size()) return false;
+    auto ib = b.begin();
+    for (const auto& [v, t, s] : a) {
+        const auto& [v2, t2, s2] = *ib;
+        if (v != v2 || t != t2 || s != s2) return false;
+        ++ib;
+    }
+    return true;
+}
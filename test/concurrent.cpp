@@ -0,0 +1,210 @@
+#include "../selective_time_series.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+
+// Samples added from many threads must end up as the best S overall, the
+// same as adding them all to one series.
+template <bool Reverse, std::size_t Extent, typename... Ps>
+int check_sharded(const char* name) {
+    constexpr std::size_t S = 100;
+    constexpr std::size_t threads = 8;
+    constexpr std::size_t per_thread = 5'000;
+
+    std::vector<float> scores(threads * per_thread);
+    std::iota(scores.begin(), scores.end(), 0.0f);
+    std::shuffle(scores.begin(), scores.end(), seeded());
+
+    selective_time_series<int, S, Reverse> reference;
+    for (std::size_t t = 0; t < scores.size(); ++t) reference.add(static_cast<int>(t), t, scores[t]);
+
+    concurrent_selective_time_series<int, Extent, Reverse, std::size_t, float, Ps...> sharded(S, 3);
+    std::vector<std::thread> producers;
+    for (std::size_t p = 0; p < threads; ++p) {
+        producers.emplace_back([&, p]() {
+            // Interleaved timestamps, so shards see them out of order
+            for (std::size_t t = p; t < scores.size(); t += threads) sharded.add(static_cast<int>(t), t, scores[t]);
+        });
+    }
+    for (auto& p : producers) p.join();
+
+    auto snapshot = sharded.snapshot();
+    auto it = snapshot->begin();
+    bool ok = snapshot->size() == reference.size();
+    for (const auto& [v, t, s] : reference) {
+        if (!ok) break;
+        const auto& [v2, t2, s2] = *it;
+        ok = v == v2 && t == t2 && s == s2;
+        ++it;
+    }
+    std::cout << "sharded " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Everything pushed and drained must end up as if added directly, and a
+// full queue must count what it drops.
+int check_ring() {
+    constexpr std::size_t S = 100;
+    constexpr std::size_t samples = 200'000;
+
+    auto e = seeded();
+    std::uniform_real_distribution<float> rnd {0.0f, 1.0f};
+    std::vector<float> scores(samples);
+    for (auto& s : scores) s = rnd(e);
+
+    selective_time_series<int, S> reference, ts;
+    for (std::size_t t = 0; t < samples; ++t) reference.add(static_cast<int>(t), t, scores[t]);
+
+    ingest_ring<decltype(ts)> ring(ts, 1000);
+    if (ring.capacity() != 1024) {
+        std::cout << "ingest_ring: wrong capacity\n";
+        return 1;
+    }
+    std::atomic<bool> done {false};
+    std::thread producer([&]() {
+        for (std::size_t t = 0; t < samples; ++t) {
+            while (!ring.push(static_cast<int>(t), t, scores[t])) std::this_thread::yield();
+        }
+        done = true;
+    });
+    while (!done) ring.drain(256);
+    producer.join();
+    ring.drain();
+
+    auto it = ts.begin();
+    bool ok = ring.depth() == 0 && ts.size() == reference.size();
+    for (const auto& [v, t, s] : reference) {
+        if (!ok) break;
+        const auto& [v2, t2, s2] = *it;
+        ok = v == v2 && t == t2 && s == s2;
+        ++it;
+    }
+
+    const std::size_t dropped = ring.dropped();
+    for (std::size_t t = 0; t < ring.capacity() + 10; ++t) ring.push(0, samples + t, 1.0f);
+    ok = ok && ring.depth() == ring.capacity() && ring.dropped() == dropped + 10;
+
+    std::cout << "ingest_ring" << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Readers running alongside the writer must only ever see states the
+// series actually went through, also while a value slab is yet to be
+// allocated.
+template <typename... Ps>
+int check_seqlock(const char* name) {
+    constexpr std::size_t S = 64;
+    constexpr std::size_t samples = 100'000;
+
+    // Each sample beats all stored ones, so the series always holds the
+    // newest S in a row, with value == timestamp and score == samples - timestamp
+    seqlock_series<selective_time_series<int, S, false, std::size_t, float, Ps...>> ts;
+    const auto valid = [](const std::tuple<int, std::size_t, float>& x) {
+        return static_cast<std::size_t>(std::get<0>(x)) == std::get<1>(x) && std::get<2>(x) == static_cast<float>(samples - std::get<1>(x));
+    };
+    std::atomic<bool> done {false};
+    std::atomic<int> bad {0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&]() {
+            std::vector<std::tuple<int, std::size_t, float>> window, best;
+            while (!done) {
+                ts.newest(10, window);
+                for (std::size_t i = 0; i < window.size(); ++i) {
+                    if (!valid(window[i]) || (i && std::get<1>(window[i]) != std::get<1>(window[i - 1]) + 1)) ++bad;
+                }
+                // The best are the newest, in order
+                ts.best(4, best);
+                for (std::size_t i = 0; i < best.size(); ++i) {
+                    if (!valid(best[i]) || (i && std::get<1>(best[i]) != std::get<1>(best[i - 1]) + 1)) ++bad;
+                }
+            }
+        });
+    }
+    for (std::size_t t = 0; t < samples; ++t) ts.add(static_cast<int>(t), t, static_cast<float>(samples - t));
+    done = true;
+    for (auto& r : readers) r.join();
+
+    std::vector<std::tuple<int, std::size_t, float>> window, best;
+    ts.newest(3, window);
+    ts.best(2 * S, best);
+    const bool ok = !bad && ts.size() == S && window.size() == 3 && std::get<1>(window[2]) == samples - 1
+                    && best.size() == S && std::get<1>(best.front()) == samples - S && std::get<1>(best.back()) == samples - 1;
+    std::cout << "seqlock_series " << name << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// The readers' copy must follow every kind of write: adds, late inserts
+// among equal timestamps, rejected samples and batches.
+template <bool Reverse, typename... Ps>
+int check_seqlock_copy(const char* name) {
+    constexpr std::size_t S = 40;
+    using series = selective_time_series<int, S, Reverse, std::size_t, float, Ps...>;
+    using sample = std::tuple<int, std::size_t, float>;
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> score(0.0f, 1.0f);
+    seqlock_series<series> ts;
+    std::size_t t = 0;
+    int v = 0;
+    bool ok = true;
+    std::vector<sample> copied, expected;
+    for (int step = 0; ok && step < 3'000; ++step) {
+        switch (gen() % 4) {
+        case 0:
+            ts.add(v++, t++, score(gen));
+            break;
+        case 1:
+            ts.insert(v++, t - std::min<std::size_t>(t, gen() % 8), score(gen));
+            break;
+        case 2: {
+            int vals[5];
+            std::size_t times[5];
+            float scs[5];
+            for (int i = 0; i < 5; ++i) { vals[i] = v++; times[i] = t++; scs[i] = score(gen); }
+            ts.add_batch(vals, times, scs, 5);
+            break;
+        }
+        default:
+            ts.write([&](series& s) { s.add(v++, t, score(gen)); });
+        }
+
+        expected.clear();
+        for (const auto& x : ts.series()) expected.emplace_back(std::get<0>(x), std::get<1>(x), std::get<2>(x));
+        ts.newest(S, copied);
+        ok = copied == expected && ts.size() == expected.size();
+        // Scores are distinct, so the best are unambiguous
+        ts.best(5, copied);
+        std::vector<sample> top = expected;
+        std::stable_sort(top.begin(), top.end(), [](const sample& a, const sample& b) { return std::get<2>(a) < std::get<2>(b); });
+        top.resize(std::min<std::size_t>(5, top.size()));
+        const auto in_order = [&](const sample& a, const sample& b) {
+            return std::find(expected.begin(), expected.end(), a) < std::find(expected.begin(), expected.end(), b);
+        };
+        std::sort(top.begin(), top.end(), in_order);
+        ok = ok && copied == top;
+    }
+    std::cout << "seqlock_series copy " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+int main() {
+    int failed = 0;
+    failed += check_sharded<false, 100>("default");
+    failed += check_sharded<true,  100, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_sharded<false, sts::dynamic, sts::worst_heap, sts::fenwick_order>("dynamic + worst_heap + fenwick_order");
+    failed += check_ring();
+    failed += check_seqlock<sts::linked_order>("linked_order");
+    failed += check_seqlock<sts::fenwick_order, sts::slab_values>("fenwick_order + slab_values");
+    failed += check_seqlock<>("default");
+    failed += check_seqlock_copy<false>("default");
+    failed += check_seqlock_copy<true, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_seqlock_copy<false, sts::minmax_heap, sts::fenwick_order, sts::slab_values>("minmax_heap + fenwick_order + slab_values");
+    return failed;
+}
@@ -0,0 +1,451 @@
+#include "../selective_time_series.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+// Every policy combination must end up in exactly the same state as the
+// default container, sample for sample.
+constexpr std::size_t S = 37;
+
+template <bool Reverse, std::size_t Extent, typename... Ps>
+int check(const char* name) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 50};
+
+    selective_time_series<int, S, Reverse, std::size_t, float, sts::dense_order> reference;
+    selective_time_series<int, Extent, Reverse, std::size_t, float, Ps...> ts(S);
+
+    for (int i = 0; i < 5'000; ++i) {
+        const float score = rnd(e);
+        reference.add(i, i, score);
+        ts.add(i, i, score);
+        if (i % 7 == 0) {
+            const auto n = static_cast<std::size_t>(i) % reference.size();
+            const float rescore = rnd(e);
+            reference.rescore(n, rescore);
+            ts.rescore(n, rescore);
+        }
+        const auto n = static_cast<std::size_t>(rnd(e)) % reference.size();
+        const auto [v, t, s] = reference[n];
+        if (!ts.has({ v, t, s }) || ts.has({ v, t + 1, s })) {
+            std::cout << name << (Reverse ? " (reverse)" : "") << ": has() wrong after " << i << " additions\n";
+            return 1;
+        }
+        if (!same(reference, ts) || std::get<2>(reference.worst()) != std::get<2>(ts.worst())
+            || std::get<1>(reference.best()) != std::get<1>(ts.best())) {
+            std::cout << name << (Reverse ? " (reverse)" : "") << ": mismatch after " << i << " additions\n";
+            return 1;
+        }
+    }
+    std::cout << name << (Reverse ? " (reverse)" : "") << ": ok\n";
+    return 0;
+}
+
+// The vectorized worst scan must pick the same slot as `std::max_element`,
+// including ties, partial last blocks and series shorter than a vector.
+template <typename T>
+int check_max_position(const char* name) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {-5, 11};
+    std::vector<T> scores;
+    for (std::size_t n = 0; n < 300; ++n) {
+        for (int round = 0; round < 10; ++round) {
+            scores.clear();
+            for (std::size_t i = 0; i < n; ++i) scores.push_back(static_cast<T>(rnd(e)) / static_cast<T>(round % 2 ? 1 : 3));
+            const auto expected = static_cast<std::size_t>(std::max_element(scores.begin(), scores.end()) - scores.begin());
+            if (sts::detail::max_position(scores.data(), n) != expected
+                || (n < 16 && sts::detail::max_position<15>(scores.data(), n) != expected)) {
+                std::cout << "max_position<" << name << ">: wrong for n = " << n << '\n';
+                return 1;
+            }
+        }
+    }
+    std::cout << "max_position<" << name << ">: ok\n";
+    return 0;
+}
+
+// Snapshots must show the series as it was when taken, however much it
+// changes afterwards.
+template <bool Reverse, std::size_t Extent, typename... Ps>
+int check_snapshots(const char* name, const std::size_t capacity = S) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 50};
+
+    using series = selective_time_series<int, Extent, Reverse, std::size_t, float, sts::cow_snapshots<8>, Ps...>;
+    series ts(capacity);
+    std::vector<std::pair<decltype(ts.snapshot()), std::vector<std::tuple<int, std::size_t, float>>>> taken;
+
+    const auto take = [&](series& from) {
+        std::vector<std::tuple<int, std::size_t, float>> expected;
+        for (const auto& [v, t, s] : from) expected.emplace_back(v, t, s);
+        taken.emplace_back(from.snapshot(), std::move(expected));
+    };
+    std::size_t t = 0;
+    for (int i = 0; i < 4'000; ++i) {
+        const int op = rnd(e);
+        if (op < 10) {
+            // Late, lands inside the order
+            ts.insert(i, t - static_cast<std::size_t>(rnd(e)) % (t + 1), rnd(e));
+        } else if (op == 10 && i % 2'000 < 1'000) {
+            const std::vector<std::tuple<int, std::size_t, float>> batch { { i, t / 2, 0.0f }, { i, t / 3, 1.0f }, { i, t, 2.0f } };
+            ts.insert_range(batch.begin(), batch.end());
+        } else {
+            ts.add(i, ++t, rnd(e));
+        }
+        if (i % 7 == 0) ts.rescore(static_cast<std::size_t>(i) % ts.size(), rnd(e));
+        // Mostly a few changes between snapshots, now and then many; long
+        // runs of snapshots after every change let the pieces split and merge
+        if (op % 2 || i % 97 == 0 || i % 2'000 >= 1'000) take(ts);
+        if (i % 97 == 1) {
+            // Only rescored since, the order is shared
+            ts.rescore(static_cast<std::size_t>(i) % ts.size(), rnd(e));
+            take(ts);
+        }
+        if (i % 500 == 250) {
+            // A copy must not change pieces the original shares
+            series copy = ts;
+            for (int j = 0; j < 3; ++j) {
+                copy.add(-j, ++t, 0.0f);
+                take(copy);
+                ts.insert(j, t - 5, 0.0f);
+                take(ts);
+            }
+        }
+    }
+    for (const auto& [snap, expected] : taken) {
+        bool ok = snap.size() == expected.size();
+        std::size_t n = 0;
+        for (const auto& [v, t, s] : snap) {
+            ok = ok && std::make_tuple(v, t, s) == expected[n++];
+        }
+        if (!ok) {
+            std::cout << "snapshots " << name << (Reverse ? " (reverse)" : "") << ": mismatch\n";
+            return 1;
+        }
+    }
+    std::cout << "snapshots " << name << (Reverse ? " (reverse)" : "") << ": ok\n";
+    return 0;
+}
+
+// Every sample that leaves the series must pass through the eviction sink,
+// exactly once, with its own timestamp and score.
+struct collect {
+    std::vector<std::tuple<int, std::size_t, float>>* evicted = nullptr;
+    void operator()(int& v, const std::size_t& t, const float& s) const { evicted->emplace_back(v, t, s); }
+};
+
+template <bool Reverse, typename... Ps>
+int check_eviction_sink(const char* name) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 50};
+
+    std::vector<std::tuple<int, std::size_t, float>> evicted, stored, added;
+    selective_time_series<int, S, Reverse, std::size_t, float, sts::eviction_sink<collect>, Ps...> ts;
+    ts.eviction_sink().evicted = &evicted;
+
+    for (int i = 0; i < 2'000; ++i) {
+        const auto sample = std::make_tuple(i, static_cast<std::size_t>(i), static_cast<float>(rnd(e)));
+        added.push_back(sample);
+        if (i % 5) {
+            ts.add(std::get<0>(sample), std::get<1>(sample), std::get<2>(sample));
+        } else {
+            // Late, so it goes through insert_one()
+            std::get<1>(added.back()) = std::get<1>(sample) - 3;
+            ts.insert(std::get<0>(sample), std::get<1>(sample) - 3, std::get<2>(sample));
+        }
+    }
+    // Stored and evicted samples together must all be distinct added ones
+    for (const auto& [v, t, s] : ts) stored.emplace_back(v, t, s);
+    std::vector<std::tuple<int, std::size_t, float>> seen(stored);
+    seen.insert(seen.end(), evicted.begin(), evicted.end());
+    std::sort(seen.begin(), seen.end());
+    bool ok = std::adjacent_find(seen.begin(), seen.end()) == seen.end()
+              && std::includes(added.begin(), added.end(), seen.begin(), seen.end())
+              && !evicted.empty();
+    // A batch of better samples evicts every stored one
+    std::vector<std::tuple<int, std::size_t, float>> batch;
+    for (int i = 0; i < 40; ++i) batch.emplace_back(3'000 + i, 3'000 + i, -1.0f);
+    const auto before = evicted.size();
+    ts.insert_range(batch.begin(), batch.end());
+    ok = ok && evicted.size() == before + S;
+
+    std::cout << "eviction_sink " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Out of line values must survive copies and moves, with only the stored
+// slots ever constructed.
+template <bool Reverse, std::size_t Extent, typename... Ps>
+int check_slab_values(const char* name) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 50};
+
+    selective_time_series<std::vector<int>, S, Reverse, std::size_t, float, sts::dense_order> reference;
+    selective_time_series<std::vector<int>, Extent, Reverse, std::size_t, float, sts::slab_values, Ps...> ts(S);
+    bool ok = true;
+    for (int i = 0; i < 1'000 && ok; ++i) {
+        const float score = rnd(e);
+        reference.add(std::vector<int>(3, i), i, score);
+        if (i % 2) {
+            ts.emplace(i, score, 3, i);
+        } else {
+            ts.add(std::vector<int>(3, i), i, score);
+        }
+        if (i % 100 == 0) {
+            auto copy = ts;
+            auto moved = std::move(copy);
+            ok = same(reference, moved);
+            ts = moved;
+        }
+        ok = ok && same(reference, ts);
+    }
+    std::cout << "slab_values " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// The tracked best K must always be the ones a full selection finds, in the
+// same order, through adds, out of order inserts, rescoring (also of samples
+// added without a score) and reindexing.
+template <bool Reverse, std::size_t Extent, typename... Ps>
+int check_top_k(const char* name) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 50};
+
+    selective_time_series<int, S, Reverse, std::size_t, float, sts::dense_order> reference;
+    selective_time_series<int, Extent, Reverse, std::size_t, float, sts::top_k<8>, Ps...> ts(S);
+    std::vector<std::tuple<int&, std::size_t&, float&>> want, got;
+    bool ok = true;
+    for (int i = 0; i < 3'000 && ok; ++i) {
+        const float score = rnd(e);
+        if (i % 5 == 3) {
+            const auto t = static_cast<std::size_t>(3 * i - rnd(e));
+            reference.insert(i, t, score);
+            ts.insert(i, t, score);
+        } else if (i % 5 == 1) {
+            // Added without a score, so among the best, then scored
+            reference.add(i, 3 * i);
+            ts.add(i, 3 * i);
+            const std::size_t newest = Reverse ? 0 : reference.size() - 1;
+            reference.rescore(newest, score);
+            ts.rescore(newest, score);
+        } else {
+            reference.add(i, 3 * i, score);
+            ts.add(i, 3 * i, score);
+        }
+        if (i % 3 == 0) {
+            const auto n = static_cast<std::size_t>(rnd(e)) % reference.size();
+            const float rescore = rnd(e);
+            reference.rescore(n, rescore);
+            ts.rescore(n, rescore);
+        }
+        if (i % 97 == 0) {
+            std::get<2>(ts[0]) = std::get<2>(reference[0]) = 0;
+            ts.reindex();
+            reference.reindex();
+        }
+        for (const std::size_t n : { 1, 5, 8, 9 }) {
+            want.clear();
+            got.clear();
+            reference.best(n, std::back_inserter(want));
+            ts.best(n, std::back_inserter(got));
+            ok = ok && want.size() == got.size();
+            for (std::size_t j = 0; ok && j < want.size(); ++j) ok = std::get<1>(want[j]) == std::get<1>(got[j]) && std::get<0>(want[j]) == std::get<0>(got[j]);
+        }
+        ok = ok && (reference.size() < 8 || reference.template best<8>() == ts.template best<8>());
+    }
+    std::cout << "top_k " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Well scored late inserts pile up in the middle of the series while
+// evictions open holes elsewhere: the Fenwick timeline has to spread windows
+// out instead of shifting ever further.
+template <bool Reverse, typename... Ps>
+int check_late_inserts(const char* name) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 1'000};
+    constexpr std::size_t L = 1'500;
+
+    selective_time_series<int, sts::dynamic, Reverse, std::size_t, float, sts::dense_order> reference(L);
+    selective_time_series<int, sts::dynamic, Reverse, std::size_t, float, Ps...> ts(L);
+    bool ok = true;
+    for (int i = 0; i < 40'000 && ok; ++i) {
+        const bool late = i >= 2'000 && i % 4 != 0;
+        const float score = late ? rnd(e) % 100 : rnd(e);
+        if (!late) {
+            reference.add(i, 4 * i, score);
+            ts.add(i, 4 * i, score);
+        } else {
+            const auto t = static_cast<std::size_t>(4 * (i - 1'000) + rnd(e) % 5);
+            reference.insert(i, t, score);
+            ts.insert(i, t, score);
+        }
+        if (i % 13 == 0) {
+            const auto n = static_cast<std::size_t>(rnd(e)) % reference.size();
+            const float rescore = rnd(e);
+            reference.rescore(n, rescore);
+            ts.rescore(n, rescore);
+        }
+        if (i % 1'000 == 0 || i % 7 == 0) {
+            const auto n = static_cast<std::size_t>(rnd(e)) % reference.size();
+            ok = (i % 1'000 != 0 || same(reference, ts)) && reference[n] == ts[n];
+        }
+    }
+    ok = ok && same(reference, ts);
+    std::cout << "late_inserts " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// Scores written in place through `[]` or an iterator must count on the next
+// add: a sample is only rejected if it scores worse than every stored one.
+// Policies that index scores get a `reindex()` after the writes.
+template <bool Reverse, std::size_t Extent, typename... Ps>
+int check_rescore_in_place(const char* name, const bool reindex) {
+    auto e = seeded();
+    std::uniform_int_distribution<> rnd {0, 50};
+
+    selective_time_series<int, Extent, Reverse, std::size_t, float, Ps...> ts(8);
+    for (int i = 0; i < 8; ++i) ts.add(i, static_cast<std::size_t>(i), 0.1f * static_cast<float>(i + 1));
+    ts.add(8, 8, 1.0f);
+    std::get<2>(ts[Reverse ? 7 : 0]) = 0.95f;
+    if (reindex) ts.reindex();
+    ts.add(100, 100, 0.9f);
+    bool ok = std::get<0>(ts[Reverse ? 0 : 7]) == 100 && std::get<2>(ts.worst()) < 0.95f;
+
+    for (int i = 0; i < 2'000 && ok; ++i) {
+        auto it = ts.begin() + static_cast<std::ptrdiff_t>(static_cast<std::size_t>(rnd(e)) % ts.size());
+        std::get<2>(*it) = static_cast<float>(rnd(e));
+        std::get<2>(ts[static_cast<std::size_t>(rnd(e)) % ts.size()]) = static_cast<float>(rnd(e));
+        if (reindex) ts.reindex();
+        float worst = 0;
+        for (const auto& [v, t, s] : ts) worst = std::max(worst, s);
+        const float score = static_cast<float>(rnd(e));
+        ts.add(1'000 + i, static_cast<std::size_t>(1'000 + i), score);
+        const bool stored = std::get<0>(ts[Reverse ? 0 : ts.size() - 1]) == 1'000 + i;
+        float now = 0;
+        for (const auto& [v, t, s] : ts) now = std::max(now, s);
+        ok = stored == !(score > worst) && now <= worst && std::get<2>(ts.worst()) == now;
+    }
+    std::cout << "rescore_in_place " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// A moved-from series must be empty and safe to use: a fixed size one keeps
+// working, a dynamic one has capacity 0 until assigned to.
+template <bool Reverse, std::size_t Extent, typename... Ps>
+int check_moved_from(const char* name) {
+    using series = selective_time_series<int, Extent, Reverse, std::size_t, float, Ps...>;
+    series reference(S);
+    bool ok = true;
+    const auto fill = [](series& ts, int from) {
+        for (int i = from; i < from + 100; ++i) ts.add(i, static_cast<std::size_t>(i), static_cast<float>(i % 11));
+    };
+    const auto usable = [&](series& ts) {
+        bool good = ts.size() == 0 && ts.begin() == ts.end() && !ts.has({ 1, 1, 1.0f }) && ts.range(0, 1'000).empty();
+        fill(ts, 0);
+        std::size_t n = 0;
+        for (const auto& x : ts) n += std::get<1>(x) < 100;
+        return good && n == ts.size() && ts.size() == (Extent == sts::dynamic ? 0 : S);
+    };
+    fill(reference, 0);
+
+    series a(S);
+    fill(a, 0);
+    series b(std::move(a));
+    ok = same(reference, b) && usable(a);
+
+    series c(S);
+    fill(c, 500);
+    c = std::move(b);
+    ok = ok && same(reference, c) && usable(b);
+
+    // A moved-from series takes new contents
+    b = c;
+    ok = ok && same(reference, b);
+    std::cout << "moved_from " << name << (Reverse ? " (reverse)" : "") << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+// A capacity the series cannot be sized for is refused before anything is
+// allocated; the largest fixed size for a one byte index still fits.
+template <typename... Ps>
+int check_capacity(const char* name) {
+    bool ok = false;
+    try { selective_time_series<int, 8, false, std::size_t, float, Ps...> ts(9); }
+    catch (const std::invalid_argument&) { ok = true; }
+    try {
+        selective_time_series<int, sts::dynamic, false, std::size_t, float, Ps...> ts(std::numeric_limits<uint32_t>::max());
+        ok = false;
+    }
+    catch (const std::length_error&) {}
+    selective_time_series<int, 255, false, std::size_t, float, Ps...> full;
+    for (int i = 0; i < 300; ++i) full.add(i, static_cast<std::size_t>(i), static_cast<float>(i % 7));
+    selective_time_series<int, sts::dynamic, false, std::size_t, float, Ps...> empty(0);
+    ok = ok && full.size() == 255 && empty.size() == 0;
+    std::cout << "capacity " << name << (ok ? ": ok\n" : ": mismatch\n");
+    return !ok;
+}
+
+int main() {
+    int failed = 0;
+    failed += check_max_position<float>("float");
+    failed += check_max_position<double>("double");
+    failed += check_max_position<int>("int");
+    failed += check<false, S>("small_order");
+    failed += check<true,  S>("small_order");
+    failed += check<true,  S, sts::small_order, sts::worst_heap, sts::timestamp_hash>("small_order + worst_heap + timestamp_hash");
+    failed += check<false, S, sts::worst_heap>("worst_heap");
+    failed += check<true,  S, sts::worst_heap>("worst_heap");
+    failed += check<false, S, sts::linked_order>("linked_order");
+    failed += check<true,  S, sts::linked_order>("linked_order");
+    failed += check<false, S, sts::linked_order, sts::worst_heap>("linked_order + worst_heap");
+    failed += check<true,  S, sts::linked_order, sts::worst_heap>("linked_order + worst_heap");
+    failed += check<false, S, sts::fenwick_order, sts::worst_heap>("fenwick_order + worst_heap");
+    failed += check<true,  S, sts::fenwick_order, sts::worst_heap>("fenwick_order + worst_heap");
+    failed += check<false, S, sts::timestamp_hash>("timestamp_hash");
+    failed += check<true,  S, sts::timestamp_hash, sts::worst_heap, sts::linked_order>("timestamp_hash + worst_heap + linked_order");
+    failed += check<false, S, sts::minmax_heap>("minmax_heap");
+    failed += check<true,  S, sts::minmax_heap, sts::linked_order>("minmax_heap + linked_order");
+    failed += check<false, sts::dynamic>("dynamic");
+    failed += check<true,  sts::dynamic, sts::minmax_heap, sts::fenwick_order>("dynamic + minmax_heap + fenwick_order");
+    failed += check<true,  sts::dynamic, sts::worst_heap, sts::fenwick_order, sts::timestamp_hash>("dynamic + worst_heap + fenwick_order + timestamp_hash");
+    failed += check_snapshots<false, S>("default");
+    failed += check_snapshots<true,  S, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_snapshots<false, sts::dynamic, sts::fenwick_order>("dynamic + fenwick_order");
+    failed += check_snapshots<true,  sts::dynamic, sts::worst_heap, sts::fenwick_order>("dynamic + worst_heap + fenwick_order", 1'500);
+    failed += check_eviction_sink<false>("default");
+    failed += check_eviction_sink<true, sts::worst_heap, sts::fenwick_order>("worst_heap + fenwick_order");
+    failed += check_slab_values<false, S>("default");
+    failed += check_slab_values<true,  S, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_slab_values<false, sts::dynamic, sts::fenwick_order, sts::cow_snapshots<8>>("dynamic + fenwick_order + cow_snapshots");
+    failed += check<false, S, sts::slab_values>("slab_values");
+    failed += check_top_k<false, S>("default");
+    failed += check_top_k<true,  S, sts::worst_heap, sts::linked_order>("worst_heap + linked_order");
+    failed += check_top_k<false, sts::dynamic, sts::fenwick_order>("dynamic + fenwick_order");
+    failed += check_top_k<true,  S, sts::minmax_heap>("minmax_heap");
+    failed += check_late_inserts<false, sts::fenwick_order, sts::worst_heap>("fenwick_order + worst_heap");
+    failed += check_late_inserts<true,  sts::fenwick_order, sts::minmax_heap>("fenwick_order + minmax_heap");
+    failed += check_late_inserts<false, sts::linked_order>("linked_order");
+    failed += check_rescore_in_place<false, 8>("default", false);
+    failed += check_rescore_in_place<true,  8>("default", false);
+    failed += check_rescore_in_place<false, sts::dynamic>("dynamic", false);
+    failed += check_rescore_in_place<true,  8, sts::dense_order>("dense_order", false);
+    failed += check_rescore_in_place<false, 8, sts::worst_cached>("worst_cached", true);
+    failed += check_rescore_in_place<true,  sts::dynamic, sts::worst_heap, sts::fenwick_order>("dynamic + worst_heap + fenwick_order", true);
+    failed += check_moved_from<false, S>("default");
+    failed += check_moved_from<true,  S, sts::worst_heap, sts::fenwick_order, sts::timestamp_hash, sts::cow_snapshots<8>, sts::slab_values>("worst_heap + fenwick_order + timestamp_hash + cow_snapshots + slab_values");
+    failed += check_moved_from<false, sts::dynamic>("dynamic");
+    failed += check_moved_from<true,  sts::dynamic, sts::minmax_heap, sts::linked_order, sts::timestamp_hash, sts::top_k<4>>("dynamic + minmax_heap + linked_order + timestamp_hash + top_k");
+    failed += check_moved_from<false, sts::dynamic, sts::fenwick_order, sts::slab_values, sts::cow_snapshots<8>>("dynamic + fenwick_order + slab_values + cow_snapshots");
+    failed += check_capacity("default");
+    failed += check_capacity<sts::linked_order, sts::timestamp_hash>("linked_order + timestamp_hash");
+    failed += check_capacity<sts::fenwick_order, sts::worst_heap>("fenwick_order + worst_heap");
+    return failed;
+}